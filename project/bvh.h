@@ -0,0 +1,602 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\frustum_culling.h>
+
+// Dynamic bounding volume hierarchy over axis-aligned boxes, for hierarchical frustum culling
+// and ray picking in O(log n) instead of a scan over every object.
+//
+// Leaves are inserted one by one next to the sibling that grows the tree's surface area the
+// least, and the path up is rebalanced with tree rotations (as in Box2D's dynamic tree). Leaf
+// boxes are stored fattened by a margin, so an object that moves a little stays where it is;
+// one that leaves its fat box is removed and inserted again. Objects that all move every frame
+// can instead update their boxes in place with setBounds() and refit() the tree once. When
+// incremental changes have made the tree poor (sahCost() grows), rebuild() rebuilds it top
+// down with a binned surface area heuristic.
+
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+inline Aabb mergeAabb(const Aabb& a, const Aabb& b)
+{
+    return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+// half the surface area, all the SAH needs
+inline float aabbArea(const Aabb& box)
+{
+    glm::vec3 d = box.max - box.min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+inline bool aabbContains(const Aabb& outer, const Aabb& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+        && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+inline Aabb sphereAabb(const glm::vec3& center, float radius)
+{
+    return { center - glm::vec3(radius), center + glm::vec3(radius) };
+}
+
+// distance along a ray (direction normalized) to a sphere, negative on a miss
+inline float raySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius)
+{
+    glm::vec3 offset = origin - center;
+    float b = glm::dot(offset, direction);
+    float c = glm::dot(offset, offset) - radius * radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f || (c > 0.0f && b > 0.0f))
+        return -1.0f;
+    return std::max(0.0f, -b - std::sqrt(discriminant));
+}
+
+struct BvhRayHit
+{
+    uint32_t object = 0;
+    float distance = 0.0f;
+};
+
+class DynamicBvh
+{
+public:
+    static const int NULL_NODE = -1;
+
+    // margin: how far a leaf's box is fattened on every side
+    DynamicBvh(float margin = 0.1f)
+        : root(NULL_NODE), freeList(NULL_NODE), leaves(0), margin(margin)
+    {
+    }
+
+    // returns the proxy of the new leaf, for move() / remove()
+    // ------------------------------------------------------------------------
+    int insert(const Aabb& bounds, uint32_t object)
+    {
+        int leaf = allocateNode();
+        nodes[leaf].bounds = fatten(bounds);
+        nodes[leaf].object = object;
+        nodes[leaf].height = 0;
+        insertLeaf(leaf);
+        leaves++;
+        return leaf;
+    }
+
+    void remove(int proxy)
+    {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        leaves--;
+    }
+
+    // new bounds for a moving object; true when it left its fat box and was inserted again
+    bool move(int proxy, const Aabb& bounds)
+    {
+        if (aabbContains(nodes[proxy].bounds, bounds))
+            return false;
+        removeLeaf(proxy);
+        nodes[proxy].bounds = fatten(bounds);
+        insertLeaf(proxy);
+        return true;
+    }
+
+    // update a leaf's box without touching the structure; the tree is stale until refit()
+    void setBounds(int proxy, const Aabb& bounds)
+    {
+        nodes[proxy].bounds = fatten(bounds);
+    }
+
+    // recompute every internal box from its children, bottom up
+    // ------------------------------------------------------------------------
+    void refit()
+    {
+        if (root == NULL_NODE)
+            return;
+        // pre-order puts every parent before its children: walk it backwards
+        order.clear();
+        order.push_back(root);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const Node& node = nodes[order[i]];
+            if (!node.leaf())
+            {
+                order.push_back(node.child[0]);
+                order.push_back(node.child[1]);
+            }
+        }
+        for (size_t i = order.size(); i-- > 0;)
+        {
+            Node& node = nodes[order[i]];
+            if (!node.leaf())
+                node.bounds = mergeAabb(nodes[node.child[0]].bounds, nodes[node.child[1]].bounds);
+        }
+    }
+
+    // throw away the internal nodes and build them again top down, splitting each node where the
+    // binned surface area heuristic is lowest; the leaves (and so the proxies) stay as they are
+    // ------------------------------------------------------------------------
+    void rebuild()
+    {
+        if (leaves < 2)
+            return;
+        std::vector<int> leafNodes;
+        leafNodes.reserve(leaves);
+        for (int i = 0; i < (int)nodes.size(); i++)
+        {
+            if (nodes[i].height == 0)
+                leafNodes.push_back(i);
+            else if (nodes[i].height > 0)
+                freeNode(i);
+        }
+        root = buildNode(leafNodes.data(), leafNodes.size());
+        nodes[root].parent = NULL_NODE;
+    }
+
+    // the objects whose boxes touch the frustum, in no particular order. Planes a node is fully
+    // inside of are not tested again below it, and a node inside all of them is taken whole.
+    // ------------------------------------------------------------------------
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& objects) const
+    {
+        objects.clear();
+        if (root == NULL_NODE)
+            return;
+        struct Entry
+        {
+            int node;
+            unsigned int planes;  // planes still to test
+        };
+        std::vector<Entry> stack;
+        stack.reserve(64);
+        stack.push_back({ root, 0x3F });
+        while (!stack.empty())
+        {
+            Entry entry = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[entry.node];
+            glm::vec3 center = 0.5f * (node.bounds.min + node.bounds.max);
+            glm::vec3 extent = 0.5f * (node.bounds.max - node.bounds.min);
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; p++)
+            {
+                if (!(entry.planes & (1u << p)))
+                    continue;
+                const glm::vec4& plane = frustum.planes[p];
+                float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+                float reach = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+                if (distance + reach < 0.0f)
+                    outside = true;
+                else if (distance - reach >= 0.0f)
+                    entry.planes &= ~(1u << p);
+            }
+            if (outside)
+                continue;
+            if (entry.planes == 0)
+                collectObjects(entry.node, objects);
+            else if (node.leaf())
+                objects.push_back(node.object);
+            else
+            {
+                stack.push_back({ node.child[0], entry.planes });
+                stack.push_back({ node.child[1], entry.planes });
+            }
+        }
+    }
+
+    // closest object along a ray (direction normalized) within maxDistance. exactHit(object)
+    // returns the distance to the object itself, or a negative value when the ray misses it
+    // inside its box; nodes farther than the closest hit so far are skipped.
+    // ------------------------------------------------------------------------
+    template <typename ExactHit>
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, ExactHit exactHit, BvhRayHit& hit) const
+    {
+        if (root == NULL_NODE)
+            return false;
+        glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        float closest = maxDistance;
+        bool found = false;
+        std::vector<int> stack;
+        stack.reserve(64);
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (rayBox(origin, inverse, node.bounds, closest) < 0.0f)
+                continue;
+            if (node.leaf())
+            {
+                float distance = exactHit(node.object);
+                if (distance >= 0.0f && distance < closest)
+                {
+                    closest = distance;
+                    hit.object = node.object;
+                    hit.distance = distance;
+                    found = true;
+                }
+                continue;
+            }
+            // visit the nearer child first, so the farther one is more often culled by closest
+            float near0 = rayBox(origin, inverse, nodes[node.child[0]].bounds, closest);
+            float near1 = rayBox(origin, inverse, nodes[node.child[1]].bounds, closest);
+            bool swap = near1 >= 0.0f && (near0 < 0.0f || near1 < near0);
+            if (near0 >= 0.0f || near1 >= 0.0f)
+            {
+                stack.push_back(swap ? node.child[0] : node.child[1]);
+                stack.push_back(swap ? node.child[1] : node.child[0]);
+            }
+        }
+        return found;
+    }
+
+    uint32_t object(int proxy) const
+    {
+        return nodes[proxy].object;
+    }
+    const Aabb& fatBounds(int proxy) const
+    {
+        return nodes[proxy].bounds;
+    }
+    size_t size() const
+    {
+        return leaves;
+    }
+    int height() const
+    {
+        return root == NULL_NODE ? 0 : nodes[root].height;
+    }
+
+    // summed area of the internal nodes relative to the root: the expected number of nodes a
+    // random ray visits, lower is better
+    float sahCost() const
+    {
+        if (root == NULL_NODE)
+            return 0.0f;
+        float area = 0.0f;
+        for (const Node& node : nodes)
+            if (node.height > 0)
+                area += aabbArea(node.bounds);
+        return area / aabbArea(nodes[root].bounds);
+    }
+
+    void print(std::ostream& out) const
+    {
+        out << "bvh: " << leaves << " objects, height " << height() << ", SAH cost " << sahCost() << std::endl;
+    }
+
+private:
+    struct Node
+    {
+        Aabb bounds;
+        int parent;       // next free node while on the free list
+        int child[2];
+        int height;       // 0 for leaves, -1 while free
+        uint32_t object;
+
+        bool leaf() const
+        {
+            return child[0] == NULL_NODE;
+        }
+    };
+
+    static const int SAH_BINS = 12;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    int root;
+    int freeList;
+    size_t leaves;
+    float margin;
+
+    Aabb fatten(const Aabb& bounds) const
+    {
+        return { bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin) };
+    }
+
+    int allocateNode()
+    {
+        if (freeList == NULL_NODE)
+        {
+            nodes.emplace_back();
+            freeList = (int)nodes.size() - 1;
+            nodes[freeList].parent = NULL_NODE;
+        }
+        int index = freeList;
+        freeList = nodes[index].parent;
+        Node& node = nodes[index];
+        node.parent = NULL_NODE;
+        node.child[0] = node.child[1] = NULL_NODE;
+        node.height = 0;
+        node.object = 0;
+        return index;
+    }
+    void freeNode(int index)
+    {
+        nodes[index].parent = freeList;
+        nodes[index].height = -1;
+        freeList = index;
+    }
+
+    // walk down to the sibling whose merge with the leaf adds the least area to the tree:
+    // the cost of a sibling is the merged box plus the growth it causes in every ancestor
+    void insertLeaf(int leaf)
+    {
+        if (root == NULL_NODE)
+        {
+            root = leaf;
+            nodes[root].parent = NULL_NODE;
+            return;
+        }
+        const Aabb leafBounds = nodes[leaf].bounds;
+        int index = root;
+        while (!nodes[index].leaf())
+        {
+            const Node& node = nodes[index];
+            float area = aabbArea(node.bounds);
+            float combined = aabbArea(mergeAabb(node.bounds, leafBounds));
+            float cost = 2.0f * combined;                    // a new parent for this node and the leaf
+            float inheritance = 2.0f * (combined - area);    // what descending costs the ancestors
+            float childCost[2];
+            for (int c = 0; c < 2; c++)
+            {
+                const Node& child = nodes[node.child[c]];
+                float merged = aabbArea(mergeAabb(child.bounds, leafBounds));
+                childCost[c] = (child.leaf() ? merged : merged - aabbArea(child.bounds)) + inheritance;
+            }
+            if (cost < childCost[0] && cost < childCost[1])
+                break;
+            index = childCost[0] < childCost[1] ? node.child[0] : node.child[1];
+        }
+
+        int sibling = index;
+        int oldParent = nodes[sibling].parent;
+        int newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].bounds = mergeAabb(leafBounds, nodes[sibling].bounds);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child[0] = sibling;
+        nodes[newParent].child[1] = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+        if (oldParent == NULL_NODE)
+            root = newParent;
+        else
+            nodes[oldParent].child[nodes[oldParent].child[0] == sibling ? 0 : 1] = newParent;
+
+        fixUpwards(newParent);
+    }
+
+    // the leaf's sibling takes the parent's place
+    void removeLeaf(int leaf)
+    {
+        if (leaf == root)
+        {
+            root = NULL_NODE;
+            return;
+        }
+        int parent = nodes[leaf].parent;
+        int grandParent = nodes[parent].parent;
+        int sibling = nodes[parent].child[nodes[parent].child[0] == leaf ? 1 : 0];
+        freeNode(parent);
+        if (grandParent == NULL_NODE)
+        {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            return;
+        }
+        nodes[grandParent].child[nodes[grandParent].child[0] == parent ? 0 : 1] = sibling;
+        nodes[sibling].parent = grandParent;
+        fixUpwards(grandParent);
+    }
+
+    // rebalance and recompute boxes and heights from a node up to the root
+    void fixUpwards(int index)
+    {
+        while (index != NULL_NODE)
+        {
+            index = balance(index);
+            Node& node = nodes[index];
+            node.height = 1 + std::max(nodes[node.child[0]].height, nodes[node.child[1]].height);
+            node.bounds = mergeAabb(nodes[node.child[0]].bounds, nodes[node.child[1]].bounds);
+            index = node.parent;
+        }
+    }
+
+    // if one child of a is more than one level taller than the other, rotate it up into a's
+    // place; returns the node now at a's position
+    int balance(int a)
+    {
+        Node& nodeA = nodes[a];
+        if (nodeA.leaf() || nodeA.height < 2)
+            return a;
+        int b = nodeA.child[0];
+        int c = nodeA.child[1];
+        int difference = nodes[c].height - nodes[b].height;
+        if (difference > 1)
+            return rotateUp(a, 1);
+        if (difference < -1)
+            return rotateUp(a, 0);
+        return a;
+    }
+
+    // child `side` of a (call it c, with children f and g) replaces a; a keeps its other child
+    // and takes the shorter of f and g, c keeps the taller one
+    int rotateUp(int a, int side)
+    {
+        int c = nodes[a].child[side];
+        int f = nodes[c].child[0];
+        int g = nodes[c].child[1];
+
+        nodes[c].child[0] = a;
+        nodes[c].parent = nodes[a].parent;
+        nodes[a].parent = c;
+        if (nodes[c].parent == NULL_NODE)
+            root = c;
+        else
+        {
+            Node& parent = nodes[nodes[c].parent];
+            parent.child[parent.child[0] == a ? 0 : 1] = c;
+        }
+
+        int taller = nodes[f].height > nodes[g].height ? f : g;
+        int shorter = taller == f ? g : f;
+        nodes[c].child[1] = taller;
+        nodes[a].child[side] = shorter;
+        nodes[shorter].parent = a;
+
+        int other = nodes[a].child[1 - side];
+        nodes[a].bounds = mergeAabb(nodes[other].bounds, nodes[shorter].bounds);
+        nodes[a].height = 1 + std::max(nodes[other].height, nodes[shorter].height);
+        nodes[c].bounds = mergeAabb(nodes[a].bounds, nodes[taller].bounds);
+        nodes[c].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+        return c;
+    }
+
+    // binned SAH split of leafNodes[0, count) along the axis where the centroids spread the most
+    int buildNode(int* leafNodes, size_t count)
+    {
+        if (count == 1)
+            return leafNodes[0];
+
+        Aabb centroids = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+        for (size_t i = 0; i < count; i++)
+        {
+            const Aabb& bounds = nodes[leafNodes[i]].bounds;
+            glm::vec3 centroid = 0.5f * (bounds.min + bounds.max);
+            centroids = mergeAabb(centroids, { centroid, centroid });
+        }
+        glm::vec3 spread = centroids.max - centroids.min;
+        int axis = spread.x > spread.y && spread.x > spread.z ? 0 : spread.y > spread.z ? 1 : 2;
+
+        size_t split = count / 2;
+        if (spread[axis] > 0.0f)
+        {
+            Aabb binBounds[SAH_BINS];
+            size_t binCounts[SAH_BINS] = {};
+            float scale = SAH_BINS / spread[axis];
+            auto binOf = [&](int leaf)
+            {
+                const Aabb& bounds = nodes[leaf].bounds;
+                float centroid = 0.5f * (bounds.min[axis] + bounds.max[axis]);
+                return std::min(SAH_BINS - 1, (int)((centroid - centroids.min[axis]) * scale));
+            };
+            for (size_t i = 0; i < count; i++)
+            {
+                int bin = binOf(leafNodes[i]);
+                binBounds[bin] = binCounts[bin]++ == 0 ? nodes[leafNodes[i]].bounds : mergeAabb(binBounds[bin], nodes[leafNodes[i]].bounds);
+            }
+
+            // cost of splitting after bin b: area * count on both sides
+            float leftCost[SAH_BINS - 1];
+            Aabb running = {};
+            size_t runningCount = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++)
+            {
+                if (binCounts[b] > 0)
+                    running = runningCount == 0 ? binBounds[b] : mergeAabb(running, binBounds[b]);
+                runningCount += binCounts[b];
+                leftCost[b] = runningCount > 0 ? aabbArea(running) * runningCount : 0.0f;
+            }
+            float bestCost = INFINITY;
+            int bestBin = -1;
+            runningCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--)
+            {
+                if (binCounts[b] > 0)
+                    running = runningCount == 0 ? binBounds[b] : mergeAabb(running, binBounds[b]);
+                runningCount += binCounts[b];
+                float cost = leftCost[b - 1] + (runningCount > 0 ? aabbArea(running) * runningCount : 0.0f);
+                if (runningCount > 0 && runningCount < count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestBin = b;
+                }
+            }
+            if (bestBin > 0)
+                split = std::partition(leafNodes, leafNodes + count, [&](int leaf) { return binOf(leaf) < bestBin; }) - leafNodes;
+        }
+        if (split == 0 || split == count)
+        {
+            // every centroid in one place (or one bin): split by position on the axis
+            split = count / 2;
+            std::nth_element(leafNodes, leafNodes + split, leafNodes + count, [&](int l, int r)
+            {
+                return nodes[l].bounds.min[axis] + nodes[l].bounds.max[axis] < nodes[r].bounds.min[axis] + nodes[r].bounds.max[axis];
+            });
+        }
+
+        int index = allocateNode();
+        int left = buildNode(leafNodes, split);
+        int right = buildNode(leafNodes + split, count - split);
+        Node& node = nodes[index];
+        node.child[0] = left;
+        node.child[1] = right;
+        node.bounds = mergeAabb(nodes[left].bounds, nodes[right].bounds);
+        node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+        nodes[left].parent = index;
+        nodes[right].parent = index;
+        return index;
+    }
+
+    void collectObjects(int index, std::vector<uint32_t>& objects) const
+    {
+        std::vector<int> stack(1, index);
+        while (!stack.empty())
+        {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.leaf())
+                objects.push_back(node.object);
+            else
+            {
+                stack.push_back(node.child[0]);
+                stack.push_back(node.child[1]);
+            }
+        }
+    }
+
+    // slab test: distance to the box along the ray (0 when starting inside), negative on a miss
+    // or when the box starts beyond maxDistance
+    static float rayBox(const glm::vec3& origin, const glm::vec3& inverse, const Aabb& box, float maxDistance)
+    {
+        float t0 = 0.0f, t1 = maxDistance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float slabNear = (box.min[axis] - origin[axis]) * inverse[axis];
+            float slabFar = (box.max[axis] - origin[axis]) * inverse[axis];
+            if (slabNear > slabFar)
+                std::swap(slabNear, slabFar);
+            t0 = slabNear > t0 ? slabNear : t0;
+            t1 = slabFar < t1 ? slabFar : t1;
+            if (t0 > t1)
+                return -1.0f;
+        }
+        return t0;
+    }
+};
+#endif
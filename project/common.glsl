@@ -0,0 +1,18 @@
+// shared declarations, #included by the shaders (see shader_preprocessor.h)
+
+struct Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// per-frame data shared by every program, written once per frame (see frame_uniforms.h)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float time;
+    Light light;
+};
\ No newline at end of file
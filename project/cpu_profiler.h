@@ -0,0 +1,235 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU instrumentation: scoped zones recorded into per-thread ring buffers, exported as
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+//   PROFILE_ZONE("draw");        // times the rest of the enclosing scope
+//   cpuProfiler().frameMark();   // once per frame, drives the flight recorder
+//
+// Each thread writes only to its own buffer, so recording a zone takes no lock: two clock
+// reads and one store. The buffers are rings, which doubles as a flight recorder: when a frame
+// runs over the budget, the last frames are written out as a trace of the hitch.
+// Defining CPU_PROFILER_ENABLED as 0 compiles the zones out entirely; at runtime setEnabled(false)
+// leaves a single relaxed load and branch per zone.
+
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+struct CpuZoneEvent
+{
+    const char* name;   // must outlive the profiler: use string literals
+    uint64_t start;     // ns since the profiler was created
+    uint64_t end;
+};
+
+class CpuProfiler
+{
+public:
+    // capacity: events kept per thread; frameHistory: frames written by the flight recorder
+    CpuProfiler(size_t capacity = 1 << 16, size_t frameHistory = 120)
+        : capacity(capacity), frameHistory(frameHistory), enabled(true), budgetNs(0), frameCount(0), cooldown(0), hitches(0)
+    {
+        epoch = std::chrono::steady_clock::now();
+    }
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    uint64_t now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    void setEnabled(bool value)
+    {
+        enabled.store(value, std::memory_order_relaxed);
+    }
+
+    // append a finished zone to the calling thread's buffer
+    // ------------------------------------------------------------------------
+    void record(const char* name, uint64_t start, uint64_t end)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        uint64_t index = buffer.count.load(std::memory_order_relaxed);
+        buffer.events[index % capacity] = CpuZoneEvent{ name, start, end };
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+    // name the calling thread in exported traces
+    void setThreadName(const char* name)
+    {
+        threadBuffer().name = name;
+    }
+
+    // flight recorder: write the last frameHistory frames to hitch_<frame>.json whenever a frame
+    // takes longer than budgetMs (0 turns it off). The first frames (startup) are ignored.
+    // ------------------------------------------------------------------------
+    void setFrameBudget(double budgetMs, const std::string& directory = ".")
+    {
+        budgetNs = (uint64_t)(budgetMs * 1e6);
+        hitchDirectory = directory;
+    }
+    void frameMark()
+    {
+        if (!isEnabled())
+            return;
+        uint64_t time = now();
+        if (frameStarts.size() < frameHistory + 1)
+            frameStarts.push_back(time);
+        else
+            frameStarts[frameCount % frameStarts.size()] = time;
+        frameCount++;
+        if (cooldown > 0)
+            cooldown--;
+
+        if (budgetNs == 0 || frameCount < 10 || frameStarts.size() < 2 || cooldown > 0)
+            return;
+        uint64_t previous = frameStarts[(frameCount - 2) % frameStarts.size()];
+        if (time - previous <= budgetNs)
+            return;
+        // the oldest frame start still in the ring opens the window
+        uint64_t from = frameStarts.size() <= frameHistory ? frameStarts[0] : frameStarts[frameCount % frameStarts.size()];
+        std::string path = hitchDirectory + "/hitch_" + std::to_string(frameCount - 2) + ".json";
+        if (writeChromeTrace(path, from, time))
+        {
+            hitches++;
+            std::printf("frame %llu took %.1f ms (budget %.1f ms): wrote %s\n", (unsigned long long)(frameCount - 2), (time - previous) / 1e6, budgetNs / 1e6, path.c_str());
+        }
+        cooldown = (unsigned int)frameHistory;  // do not write overlapping reports
+    }
+    unsigned int hitchCount() const
+    {
+        return hitches;
+    }
+
+    // every buffered zone that overlaps [from, to] (in now() time) as Chrome trace JSON
+    // ------------------------------------------------------------------------
+    bool writeChromeTrace(const std::string& path, uint64_t from = 0, uint64_t to = UINT64_MAX)
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (size_t thread = 0; thread < buffers.size(); thread++)
+        {
+            const ThreadBuffer& buffer = *buffers[thread];
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                          first ? "" : ",\n", thread, buffer.name.c_str());
+            file << line;
+            first = false;
+
+            // the oldest slots may be overwritten while we read: keep a safety margin behind the writer
+            uint64_t count = buffer.count.load(std::memory_order_acquire);
+            uint64_t margin = capacity / 16;
+            uint64_t begin = count > capacity - margin ? count - (capacity - margin) : 0;
+            for (uint64_t i = begin; i < count; i++)
+            {
+                const CpuZoneEvent& event = buffer.events[i % capacity];
+                if (event.end < from || event.start > to)
+                    continue;
+                std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                              event.name, thread, event.start / 1e3, (event.end - event.start) / 1e3);
+                file << line;
+            }
+        }
+        file << "\n]}\n";
+        return (bool)file;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        std::vector<CpuZoneEvent> events;
+        std::atomic<uint64_t> count{ 0 };
+        std::string name;
+    };
+
+    std::chrono::steady_clock::time_point epoch;
+    size_t capacity;
+    size_t frameHistory;
+    std::atomic<bool> enabled;
+    std::mutex buffersMutex;                            // only taken to register a thread or export
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; // never shrinks, so threads may exit at any time
+    std::vector<uint64_t> frameStarts;                  // ring of the last frameHistory + 1 frame starts
+    uint64_t budgetNs;
+    uint64_t frameCount;
+    unsigned int cooldown;
+    unsigned int hitches;
+    std::string hitchDirectory;
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* local = NULL;
+        if (local == NULL)
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.emplace_back(new ThreadBuffer());
+            local = buffers.back().get();
+            local->events.resize(capacity);
+            local->name = "thread " + std::to_string(buffers.size() - 1);
+        }
+        return *local;
+    }
+};
+
+// the process-wide profiler; the per-thread buffers assume there is only this one
+inline CpuProfiler& cpuProfiler()
+{
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+// ------------------------------------------------------------------------
+class CpuZone
+{
+public:
+    explicit CpuZone(const char* name)
+        : name(name), start(0)
+    {
+        if (cpuProfiler().isEnabled())
+            start = cpuProfiler().now() | 1;  // never 0, which marks a disabled zone
+    }
+    ~CpuZone()
+    {
+        close();
+    }
+    // end the zone before the scope does
+    void close()
+    {
+        if (start != 0)
+            cpuProfiler().record(name, start, cpuProfiler().now());
+        start = 0;
+    }
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#if CPU_PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
+#endif
@@ -0,0 +1,132 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\camera.h>
+
+// Fixed-timestep simulation clock: real frame time goes into an accumulator and the simulation
+// advances in steps of exactly 1/rate seconds, however long the frames are. A frame renders the
+// state between the last two steps, interpolated by alpha(), so motion stays smooth when the
+// render and simulation rates do not divide. The same inputs and frame times always give the
+// same steps, whatever the render rate.
+//
+//   simulation.beginFrame(now);
+//   while (simulation.step())
+//       update(simulation.stepLength());    // simulation.time() is the time being stepped to
+//   render(interpolate(previous, current, simulation.alpha()), simulation.renderTime());
+//
+// Spiral-of-death guard: when a frame took so long that it would need more than maxSteps steps
+// (and those steps would make the next frame longer still), the time beyond that is dropped and
+// the simulation runs slower than real time until the frames catch up.
+class FixedTimestep
+{
+public:
+    FixedTimestep(double rate = 120.0, unsigned int maxSteps = 8)
+        : length(1.0 / rate), maxSteps(maxSteps)
+    {
+    }
+
+    // ------------------------------------------------------------------------
+    void beginFrame(double now)
+    {
+        if (frames++ == 0)
+            last = now;
+        accumulator += std::max(0.0, now - last);
+        last = now;
+
+        double limit = maxSteps * length;
+        if (accumulator >= limit + length)
+        {
+            double keep = limit + std::fmod(accumulator, length);
+            droppedTime += accumulator - keep;
+            accumulator = keep;
+            guardedFrames++;
+        }
+    }
+    // true while another step fits into the accumulated time; counts the step
+    bool step()
+    {
+        // frame times are rarely exact multiples of the step: don't leave a rounding error behind
+        if (accumulator + EPSILON < length)
+            return false;
+        accumulator = std::max(0.0, accumulator - length);
+        steps++;
+        return true;
+    }
+
+    double stepLength() const
+    {
+        return length;
+    }
+    // time of the newest simulated state
+    double time() const
+    {
+        return steps * length;
+    }
+    // how far the frame is from the previous state towards the newest one, [0, 1]
+    float alpha() const
+    {
+        return (float)std::min(1.0, accumulator / length);
+    }
+    // time of the interpolated state a frame shows
+    double renderTime() const
+    {
+        return std::max(0.0, time() - length * (1.0 - alpha()));
+    }
+
+    void print(std::ostream& out) const
+    {
+        if (frames == 0)
+            return;
+        out << "simulation: " << 1.0 / length << " Hz, " << steps << " steps, " << (double)steps / frames << " per frame";
+        if (guardedFrames > 0)
+            out << "; over " << maxSteps << " steps in " << guardedFrames << " frames, " << droppedTime * 1000.0 << " ms dropped";
+        out << std::endl;
+    }
+
+private:
+    static constexpr double EPSILON = 1e-7;
+
+    double length;
+    unsigned int maxSteps;
+    double accumulator = 0.0;
+    double last = 0.0;
+    uint64_t steps = 0;
+    uint64_t frames = 0;
+    uint64_t guardedFrames = 0;
+    double droppedTime = 0.0;
+};
+
+// the simulated part of the camera: position and orientation, captured before each step so a
+// frame can show the camera between the last two steps
+struct CameraPose
+{
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+
+    static CameraPose of(const Camera& camera)
+    {
+        return CameraPose{ camera.Position, camera.Yaw, camera.Pitch };
+    }
+    void applyTo(Camera& camera) const
+    {
+        camera.Position = position;
+        camera.Yaw = yaw;
+        camera.Pitch = pitch;
+        camera.ProcessMouseMovement(0.0f, 0.0f);  // recompute Front/Right/Up from Yaw and Pitch
+    }
+};
+
+// yaw takes the short way round, so a camera turning through +-180 degrees does not spin back
+// ------------------------------------------------------------------------
+inline CameraPose interpolatePose(const CameraPose& from, const CameraPose& to, float alpha)
+{
+    float yawDelta = std::remainder(to.yaw - from.yaw, 360.0f);
+    return CameraPose{ glm::mix(from.position, to.position, alpha), from.yaw + yawDelta * alpha, glm::mix(from.pitch, to.pitch, alpha) };
+}
+#endif
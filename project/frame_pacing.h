@@ -0,0 +1,152 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\cpu_profiler.h>
+
+// Frame pacing for low latency. Left alone, the driver lets the CPU queue several frames ahead
+// of the GPU, and every queued frame is one more frame between reading input and showing it.
+//  - frames in flight: each frame ends with a fence, and the next frame does not start before
+//    the fence of the frame framesInFlight back has signalled (1 = the GPU has finished the
+//    previous frame, 3 = about the usual driver queue)
+//  - frame limiter: frames start on a fixed period, sleeping until just before the deadline
+//    and spinning the rest, so input is read as late as the period allows rather than right
+//    after the previous frame
+// It also measures input-to-submit latency: from the moment the input a frame shows was read
+// (markInput) to the moment its draws were handed to the driver (markSubmit).
+class FramePacer
+{
+public:
+    static constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 3;
+
+    // framesInFlight: 0 leaves the queue depth to the driver; targetFps: 0 turns the limiter off
+    // history: how many of the most recent frames the latency percentiles cover
+    FramePacer(unsigned int framesInFlight = 0, double targetFps = 0.0, size_t history = 240)
+        : framesInFlight(std::min(framesInFlight, MAX_FRAMES_IN_FLIGHT)), period(targetFps > 0.0 ? 1.0 / targetFps : 0.0), history(history)
+    {
+        for (GLsync& fence : fences)
+            fence = 0;
+    }
+
+    // before anything of the frame happens, input included
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (framesInFlight > 0 && fences[next])
+        {
+            PROFILE_ZONE("wait frames in flight");
+            auto start = Clock::now();
+            while (glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(fences[next]);
+            fences[next] = 0;
+            fenceWait += seconds(Clock::now() - start);
+        }
+        if (period > 0.0)
+            waitForDeadline();
+        frames++;
+    }
+    // after the frame was submitted (and swapped)
+    void endFrame()
+    {
+        if (framesInFlight == 0)
+            return;
+        fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        next = (next + 1) % framesInFlight;
+    }
+
+    // the input this frame is going to show was read now; markSubmit() once its draws are issued
+    void markInput()
+    {
+        inputTime = Clock::now();
+    }
+    void markSubmit()
+    {
+        double ms = seconds(Clock::now() - inputTime) * 1000.0;
+        if (latencies.size() < history)
+            latencies.push_back(ms);
+        else
+            latencies[nextLatency] = ms;
+        nextLatency = (nextLatency + 1) % history;
+    }
+
+    void print(std::ostream& out) const
+    {
+        if (frames == 0)
+            return;
+        out << "frame pacing: " << (framesInFlight > 0 ? std::to_string(framesInFlight) : std::string("driver default")) << " frames in flight, "
+            << (period > 0.0 ? "limited to " + std::to_string((int)std::lround(1.0 / period)) + " Hz" : std::string("no limiter"))
+            << "; per frame " << fenceWait * 1000.0 / frames << " ms waiting on the GPU, " << limiterSleep * 1000.0 / frames << " ms in the limiter" << std::endl;
+        if (latencies.empty())
+            return;
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) { return sorted[std::max((size_t)1, (size_t)std::ceil(p * sorted.size())) - 1]; };
+        out << "input to submit ms (last " << sorted.size() << " frames): p50 " << percentile(0.5) << "  p90 " << percentile(0.9) << "  p99 " << percentile(0.99) << "  max " << sorted.back() << std::endl;
+    }
+
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        for (GLsync& fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // the OS may oversleep by about a scheduler tick, so the last stretch is spun
+    static constexpr double SPIN_MARGIN = 0.002;
+
+    unsigned int framesInFlight;
+    double period;
+    GLsync fences[MAX_FRAMES_IN_FLIGHT];
+    unsigned int next = 0;
+    Clock::time_point deadline;
+    bool started = false;
+
+    Clock::time_point inputTime;
+    size_t history;
+    std::vector<double> latencies;  // ring of the last `history` input-to-submit times in ms
+    size_t nextLatency = 0;
+    uint64_t frames = 0;
+    double fenceWait = 0.0;
+    double limiterSleep = 0.0;
+
+    static double seconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    void waitForDeadline()
+    {
+        PROFILE_ZONE("frame limiter");
+        Clock::time_point now = Clock::now();
+        Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+        // a frame that ran over starts a new schedule instead of rushing the next ones
+        if (!started || now > deadline + step)
+            deadline = now;
+        started = true;
+        Clock::duration margin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(SPIN_MARGIN));
+        if (deadline - now > margin)
+            std::this_thread::sleep_for(deadline - now - margin);
+        while (Clock::now() < deadline)
+            std::this_thread::yield();
+        limiterSleep += seconds(Clock::now() - now);
+        deadline += step;
+    }
+};
+#endif
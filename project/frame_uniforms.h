@@ -0,0 +1,65 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+
+// binding point of the per-frame uniform block; every shader declares
+// "layout (std140, binding = 0) uniform FrameData" with the same members
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+
+// std140 mirror of the Light struct in the shaders: every vec3 starts on a 16 byte boundary
+struct FrameLight
+{
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+// std140 mirror of the FrameData uniform block
+struct FrameData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float time;             // packs into the last component of viewPos
+    FrameLight light;
+};
+static_assert(offsetof(FrameData, projection) == 64, "FrameData must match the std140 layout");
+static_assert(offsetof(FrameData, viewPos) == 128, "FrameData must match the std140 layout");
+static_assert(offsetof(FrameData, time) == 140, "FrameData must match the std140 layout");
+static_assert(offsetof(FrameData, light) == 144, "FrameData must match the std140 layout");
+static_assert(sizeof(FrameData) == 208, "FrameData must match the std140 layout");
+
+// owns the uniform buffer behind the FrameData block. It is written once per frame
+// and stays bound to FRAME_UNIFORM_BINDING, so any number of programs read the same data.
+class FrameUniforms
+{
+public:
+    unsigned int ID;
+
+    FrameUniforms()
+    {
+        glGenBuffers(1, &ID);
+        glState().bindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+        glState().bindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, ID);
+    }
+
+    // upload this frame's data with a single buffer update
+    // ------------------------------------------------------------------------
+    void update(const FrameData& data)
+    {
+        glState().bindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+    }
+};
+#endif
@@ -0,0 +1,326 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\cpu_profiler.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\job_system.h>
+
+// View frustum culling of bounding spheres. The spheres are kept in structure-of-arrays form
+// (one array per coordinate plus the radius) so the SSE and AVX2 kernels test 4 or 8 of them
+// against a plane with one instruction each; the result is a compact, ascending list of the
+// indices of the visible spheres, which is what the draw stage walks.
+//
+// Like the image kernels, every level (scalar, SSE, AVX2) is picked at runtime and gives exactly
+// the same list: the SIMD paths do the same multiplies and adds in the same order, just wider.
+// Large sets are split into chunks culled in parallel as jobs of a JobSystem by FrustumCuller.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CULL_TARGET_SSE
+#define CULL_TARGET_AVX2
+#else
+#define CULL_TARGET_SSE __attribute__((target("sse2")))
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define CULL_KERNELS_X86 0
+#endif
+
+enum CullLevel
+{
+    CULL_SCALAR,
+    CULL_SSE,
+    CULL_AVX2,
+};
+
+inline const char* cullLevelName(CullLevel level)
+{
+    return level == CULL_AVX2 ? "avx2" : level == CULL_SSE ? "sse" : "scalar";
+}
+
+// the best level this CPU (and OS, for the AVX registers) supports
+// ------------------------------------------------------------------------
+inline CullLevel detectCullLevel()
+{
+#if CULL_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool sse2 = (regs[3] & (1 << 26)) != 0;
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx2 = false;
+    if (osxsave && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(regs, 7, 0);
+        avx2 = (regs[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return CULL_AVX2;
+    if (sse2)
+        return CULL_SSE;
+#endif
+    return CULL_SCALAR;
+}
+
+// level used by the kernels; lowered by benchmarks to time the fallbacks
+inline CullLevel& cullLevel()
+{
+    static CullLevel level = detectCullLevel();
+    return level;
+}
+
+// the six planes of a frustum, normals pointing inwards and normalized:
+// a point p is inside plane i when dot(planes[i].xyz, p) + planes[i].w >= 0
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann: the planes are sums and differences of the rows of projection * view
+// (GL clip space, -w <= x, y, z <= w), so they come out in world space
+// ------------------------------------------------------------------------
+inline Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];  // left
+    frustum.planes[1] = rows[3] - rows[0];  // right
+    frustum.planes[2] = rows[3] + rows[1];  // bottom
+    frustum.planes[3] = rows[3] - rows[1];  // top
+    frustum.planes[4] = rows[3] + rows[2];  // near
+    frustum.planes[5] = rows[3] - rows[2];  // far
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+// bounding spheres in structure-of-arrays layout
+// ------------------------------------------------------------------------
+struct BoundingSpheres
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    void resize(size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        radius.resize(count);
+    }
+    void set(size_t i, const glm::vec3& center, float r)
+    {
+        x[i] = center.x;
+        y[i] = center.y;
+        z[i] = center.z;
+        radius[i] = r;
+    }
+    size_t size() const
+    {
+        return x.size();
+    }
+};
+
+// ------------------------------------------------------------------------
+// kernels: test spheres [begin, end) and write the visible indices to visible, returning their
+// count. The SIMD kernels stop at the last full group and return how far they got in done.
+// ------------------------------------------------------------------------
+inline size_t cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* visible)
+{
+    size_t count = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w;
+            inside = distance + spheres.radius[i] >= 0.0f;
+        }
+        visible[count] = (uint32_t)i;
+        count += inside ? 1 : 0;
+    }
+    return count;
+}
+
+#if CULL_KERNELS_X86
+CULL_TARGET_SSE inline size_t cullSpheresSse(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* visible, size_t& done)
+{
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; p++)
+        for (int c = 0; c < 4; c++)
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t count = 0;
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 radius = _mm_loadu_ps(&spheres.radius[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)), _mm_mul_ps(planes[p][2], z)), planes[p][3]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+        // store every lane, advance past the visible ones only
+        int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            visible[count] = (uint32_t)(i + lane);
+            count += (mask >> lane) & 1;
+        }
+    }
+    done = i;
+    return count;
+}
+
+// for each 8 bit lane mask: the indices of its set lanes packed 3 bits each from the bottom,
+// and the number of set lanes in bits 24-27
+inline const uint32_t* cullCompactionTable()
+{
+    static const std::vector<uint32_t> table = []
+    {
+        std::vector<uint32_t> t(256);
+        for (uint32_t mask = 0; mask < 256; mask++)
+        {
+            uint32_t packed = 0, slot = 0;
+            for (uint32_t lane = 0; lane < 8; lane++)
+                if (mask & (1u << lane))
+                    packed |= lane << (3 * slot++);
+            t[mask] = packed | (slot << 24);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+CULL_TARGET_AVX2 inline size_t cullSpheresAvx2(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* visible, size_t& done)
+{
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; p++)
+        for (int c = 0; c < 4; c++)
+            planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i laneShifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i laneBits = _mm256_set1_epi32(7);
+    const uint32_t* compaction = cullCompactionTable();
+
+    size_t count = 0;
+    size_t i = begin;
+    __m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)begin), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+        __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+        __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+        __m256 radius = _mm256_loadu_ps(&spheres.radius[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)), _mm256_mul_ps(planes[p][2], z)), planes[p][3]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+        // move the visible lanes' indices to the front and store all 8; count <= i - begin,
+        // so the store never reaches past visible[end - begin - 1]
+        uint32_t entry = compaction[_mm256_movemask_ps(inside)];
+        __m256i order = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)entry), laneShifts), laneBits);
+        _mm256_storeu_si256((__m256i*)(visible + count), _mm256_permutevar8x32_epi32(indices, order));
+        count += entry >> 24;
+        indices = _mm256_add_epi32(indices, _mm256_set1_epi32(8));
+    }
+    done = i;
+    return count;
+}
+#endif
+
+// cull spheres [begin, end) at the current level; visible needs end - begin entries
+// ------------------------------------------------------------------------
+inline size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* visible)
+{
+    size_t count = 0;
+    size_t done = begin;
+#if CULL_KERNELS_X86
+    if (cullLevel() == CULL_AVX2)
+        count = cullSpheresAvx2(frustum, spheres, begin, end, visible, done);
+    else if (cullLevel() == CULL_SSE)
+        count = cullSpheresSse(frustum, spheres, begin, end, visible, done);
+#endif
+    return count + cullSpheresScalar(frustum, spheres, done, end, visible + count);
+}
+
+// Culls a BoundingSpheres set into a visible-index list, split across the threads of a
+// JobSystem once it is large enough to be worth it. Each chunk writes its indices into its own
+// part of the list and the parts are then moved together, so the order is always ascending.
+class FrustumCuller
+{
+public:
+    static const size_t MIN_CHUNK = 16384;  // smaller sets are culled on the calling thread only
+
+    FrustumCuller(JobSystem& jobs)
+        : jobs(jobs)
+    {
+    }
+    FrustumCuller(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+    unsigned int threadCount() const
+    {
+        return jobs.threadCount();
+    }
+
+    // indices of the spheres touching the frustum, ascending; valid until the next cull()
+    // ------------------------------------------------------------------------
+    const std::vector<uint32_t>& cull(const Frustum& frustum, const BoundingSpheres& spheres)
+    {
+        size_t total = spheres.size();
+        size_t chunks = std::max<size_t>(1, std::min<size_t>(jobs.threadCount(), total / MIN_CHUNK));
+        size_t chunkSize = (total + chunks - 1) / chunks;
+        visible.resize(total);
+        counts.assign(chunks, 0);
+        jobs.run(chunks, [&](size_t chunk, unsigned int)
+        {
+            PROFILE_ZONE("cull chunk");
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(begin + chunkSize, total);
+            if (begin < end)
+                counts[chunk] = cullSpheres(frustum, spheres, begin, end, visible.data() + begin);
+        });
+
+        // chunk c wrote its indices at c * chunkSize; close the gaps
+        size_t count = counts[0];
+        for (size_t c = 1; c < chunks; c++)
+        {
+            std::memmove(visible.data() + count, visible.data() + c * chunkSize, counts[c] * sizeof(uint32_t));
+            count += counts[c];
+        }
+        visible.resize(count);
+        return visible;
+    }
+
+private:
+    JobSystem& jobs;
+    std::vector<uint32_t> visible;
+    std::vector<size_t> counts;
+};
+#endif
@@ -0,0 +1,122 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// The glad loader is generated for core 3.3 without extensions. Entry points and enums from
+// later versions or extensions that the project uses are loaded here, after gladLoadGLLoader(),
+// and each feature is only flagged available when the context actually provides it.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+struct GLExtensions
+{
+    // GL 4.1 / ARB_get_program_binary
+    bool programBinary = false;
+    void (APIENTRY* GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) = NULL;
+    void (APIENTRY* ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) = NULL;
+    void (APIENTRY* ProgramParameteri)(GLuint program, GLenum pname, GLint value) = NULL;
+
+    // KHR_parallel_shader_compile (or the ARB original): compiles and links run on driver threads
+    // and GL_COMPLETION_STATUS_KHR can be polled without blocking
+    bool parallelShaderCompile = false;
+    void (APIENTRY* MaxShaderCompilerThreads)(GLuint count) = NULL;
+
+    // GL 4.2 / ARB_base_instance: instanced draws can start at any instance of the bound buffers
+    bool baseInstance = false;
+    void (APIENTRY* DrawElementsInstancedBaseInstance)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLuint baseinstance) = NULL;
+
+    // ARB_bindless_texture: shaders sample textures through 64-bit handles instead of units
+    bool bindlessTexture = false;
+    GLuint64 (APIENTRY* GetTextureHandleARB)(GLuint texture) = NULL;
+    void (APIENTRY* MakeTextureHandleResidentARB)(GLuint64 handle) = NULL;
+    void (APIENTRY* MakeTextureHandleNonResidentARB)(GLuint64 handle) = NULL;
+};
+
+inline GLExtensions& glExtensions()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+// ------------------------------------------------------------------------
+inline bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+            return true;
+    return false;
+}
+
+inline bool hasGLVersion(int major, int minor)
+{
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+// call once the context is current and glad is loaded, with the same loader
+// ------------------------------------------------------------------------
+inline void loadGLExtensions(GLADloadproc load)
+{
+    GLExtensions& ext = glExtensions();
+    ext = GLExtensions();
+
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary = (decltype(ext.GetProgramBinary))load("glGetProgramBinary");
+        ext.ProgramBinary = (decltype(ext.ProgramBinary))load("glProgramBinary");
+        ext.ProgramParameteri = (decltype(ext.ProgramParameteri))load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        // a driver may support the entry points yet offer no binary format at all
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (decltype(ext.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (decltype(ext.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsARB");
+    if (ext.MaxShaderCompilerThreads)
+    {
+        ext.MaxShaderCompilerThreads(0xFFFFFFFF);  // let the driver pick the thread count
+        ext.parallelShaderCompile = true;
+    }
+
+    if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance"))
+    {
+        ext.DrawElementsInstancedBaseInstance = (decltype(ext.DrawElementsInstancedBaseInstance))load("glDrawElementsInstancedBaseInstance");
+        ext.baseInstance = ext.DrawElementsInstancedBaseInstance != NULL;
+    }
+
+    if (hasGLExtension("GL_ARB_bindless_texture"))
+    {
+        ext.GetTextureHandleARB = (decltype(ext.GetTextureHandleARB))load("glGetTextureHandleARB");
+        ext.MakeTextureHandleResidentARB = (decltype(ext.MakeTextureHandleResidentARB))load("glMakeTextureHandleResidentARB");
+        ext.MakeTextureHandleNonResidentARB = (decltype(ext.MakeTextureHandleNonResidentARB))load("glMakeTextureHandleNonResidentARB");
+        ext.bindlessTexture = ext.GetTextureHandleARB && ext.MakeTextureHandleResidentARB && ext.MakeTextureHandleNonResidentARB;
+    }
+}
+#endif
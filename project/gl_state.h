@@ -0,0 +1,339 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_ext.h>
+
+// Shadow copy of the GL binding state the renderer touches every frame: the current program,
+// vertex array, buffer bindings, textures per unit, the active unit and a few pipeline switches
+// (capabilities, depth and blend functions). Every change goes through glState(); calls that
+// would leave the driver state as it is are dropped and counted instead of being issued.
+//
+// The cache only knows what went through it. Code that binds behind its back has to go
+// through it too (or call invalidate() afterwards), and deleting a bound texture or buffer
+// has to be reported, because GL silently rebinds 0 in its place. Deleted programs are reported
+// as well: a program stays in use until another one is bound, but its name may be handed out again.
+
+enum GLStateKind
+{
+    GL_STATE_PROGRAM,
+    GL_STATE_VERTEX_ARRAY,
+    GL_STATE_BUFFER,
+    GL_STATE_TEXTURE,
+    GL_STATE_ACTIVE_TEXTURE,
+    GL_STATE_PIPELINE,  // enable/disable, depth and blend state
+    GL_STATE_KIND_COUNT
+};
+
+struct GLStateCounters
+{
+    unsigned int issued[GL_STATE_KIND_COUNT] = {};
+    unsigned int elided[GL_STATE_KIND_COUNT] = {};
+
+    unsigned int totalIssued() const
+    {
+        unsigned int total = 0;
+        for (unsigned int count : issued)
+            total += count;
+        return total;
+    }
+    unsigned int totalElided() const
+    {
+        unsigned int total = 0;
+        for (unsigned int count : elided)
+            total += count;
+        return total;
+    }
+};
+
+inline const char* glStateKindName(int kind)
+{
+    static const char* names[GL_STATE_KIND_COUNT] = { "program", "vertex array", "buffer", "texture", "active texture", "pipeline" };
+    return names[kind];
+}
+
+class GLStateCache
+{
+public:
+    static const unsigned int TEXTURE_UNITS = 16;
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    GLStateCache()
+    {
+        invalidate();
+    }
+
+    // forget everything, so the next call of each kind reaches the driver
+    // ------------------------------------------------------------------------
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (GLuint& buffer : buffers)
+            buffer = UNKNOWN;
+        for (auto& unit : textures)
+            for (GLuint& texture : unit)
+                texture = UNKNOWN;
+        for (int& capability : capabilities)
+            capability = -1;
+        depthFunction = UNKNOWN;
+        depthWrite = -1;
+        blendSource = blendDestination = UNKNOWN;
+    }
+
+    void useProgram(GLuint id)
+    {
+        if (!changed(GL_STATE_PROGRAM, program, id))
+            return;
+        glUseProgram(id);
+    }
+    GLuint currentProgram() const { return program; }
+
+    // the element array binding belongs to the vertex array, so it is forgotten on a switch
+    void bindVertexArray(GLuint id)
+    {
+        if (!changed(GL_STATE_VERTEX_ARRAY, vertexArray, id))
+            return;
+        glBindVertexArray(id);
+        buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+
+    void bindBuffer(GLenum target, GLuint id)
+    {
+        int slot = bufferSlot(target);
+        if (slot < 0)
+        {
+            counters.issued[GL_STATE_BUFFER]++;
+            glBindBuffer(target, id);
+            return;
+        }
+        if (!changed(GL_STATE_BUFFER, buffers[slot], id))
+            return;
+        glBindBuffer(target, id);
+    }
+    // indexed bindings are not tracked, but they also replace the generic binding of the target
+    void bindBufferBase(GLenum target, GLuint index, GLuint id)
+    {
+        counters.issued[GL_STATE_BUFFER]++;
+        glBindBufferBase(target, index, id);
+        int slot = bufferSlot(target);
+        if (slot >= 0)
+            buffers[slot] = id;
+    }
+
+    void activeTexture(unsigned int unit)
+    {
+        if (!changed(GL_STATE_ACTIVE_TEXTURE, activeUnit, unit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    // bind to a given unit, switching the active unit only when the binding actually changes
+    void bindTexture(unsigned int unit, GLenum target, GLuint id)
+    {
+        int slot = textureSlot(target);
+        if (unit >= TEXTURE_UNITS || slot < 0)
+        {
+            activeTexture(unit);
+            counters.issued[GL_STATE_TEXTURE]++;
+            glBindTexture(target, id);
+            return;
+        }
+        if (!changed(GL_STATE_TEXTURE, textures[unit][slot], id))
+            return;
+        activeTexture(unit);
+        glBindTexture(target, id);
+    }
+    // bind on whichever unit is active, for uploads and parameter changes
+    void bindTexture(GLenum target, GLuint id)
+    {
+        if (activeUnit == UNKNOWN)
+            activeTexture(0);
+        bindTexture(activeUnit, target, id);
+    }
+
+    void enable(GLenum capability, bool on = true)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot >= 0 && capabilities[slot] == (int)on)
+        {
+            counters.elided[GL_STATE_PIPELINE]++;
+            return;
+        }
+        counters.issued[GL_STATE_PIPELINE]++;
+        if (on)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        if (slot >= 0)
+            capabilities[slot] = (int)on;
+    }
+    void disable(GLenum capability)
+    {
+        enable(capability, false);
+    }
+    void depthFunc(GLenum function)
+    {
+        if (!changed(GL_STATE_PIPELINE, depthFunction, function))
+            return;
+        glDepthFunc(function);
+    }
+    void depthMask(bool write)
+    {
+        if (depthWrite == (int)write)
+        {
+            counters.elided[GL_STATE_PIPELINE]++;
+            return;
+        }
+        counters.issued[GL_STATE_PIPELINE]++;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+        depthWrite = (int)write;
+    }
+    void blendFunc(GLenum source, GLenum destination)
+    {
+        if (blendSource == source && blendDestination == destination)
+        {
+            counters.elided[GL_STATE_PIPELINE]++;
+            return;
+        }
+        counters.issued[GL_STATE_PIPELINE]++;
+        glBlendFunc(source, destination);
+        blendSource = source;
+        blendDestination = destination;
+    }
+
+    // GL rebinds 0 wherever a deleted object was bound; mirror that before the name is reused
+    // ------------------------------------------------------------------------
+    void textureDeleted(GLuint id)
+    {
+        for (auto& unit : textures)
+            for (GLuint& texture : unit)
+                if (texture == id)
+                    texture = 0;
+    }
+    void bufferDeleted(GLuint id)
+    {
+        for (GLuint& buffer : buffers)
+            if (buffer == id)
+                buffer = 0;
+    }
+    void vertexArrayDeleted(GLuint id)
+    {
+        if (vertexArray == id)
+            vertexArray = 0;
+    }
+    // the current program keeps running after glDeleteProgram, so the next useProgram() must not be
+    // dropped even if a new program reuses the name
+    void programDeleted(GLuint id)
+    {
+        if (program == id)
+            program = UNKNOWN;
+    }
+
+    // per-frame counters: endFrame() keeps the finished frame's and adds them to the totals
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        last = counters;
+        for (int kind = 0; kind < GL_STATE_KIND_COUNT; kind++)
+        {
+            total.issued[kind] += counters.issued[kind];
+            total.elided[kind] += counters.elided[kind];
+        }
+        counters = GLStateCounters();
+        frames++;
+    }
+    const GLStateCounters& lastFrame() const { return last; }
+
+    void print(std::ostream& out) const
+    {
+        if (frames == 0)
+            return;
+        out << "GL state calls per frame (issued / elided):";
+        for (int kind = 0; kind < GL_STATE_KIND_COUNT; kind++)
+        {
+            if (total.issued[kind] + total.elided[kind] > 0)
+                out << "  " << glStateKindName(kind) << " " << (double)total.issued[kind] / frames << " / " << (double)total.elided[kind] / frames;
+        }
+        out << std::endl;
+    }
+
+private:
+    static const int BUFFER_TARGETS = 7;
+    static const int TEXTURE_TARGETS = 3;
+    static const int CAPABILITIES = 5;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint buffers[BUFFER_TARGETS];
+    GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+    int capabilities[CAPABILITIES];  // -1 unknown, 0 off, 1 on
+    GLenum depthFunction;
+    int depthWrite;
+    GLenum blendSource, blendDestination;
+
+    GLStateCounters counters, last, total;
+    unsigned int frames = 0;
+
+    // count the call and record the new value; false when it would not change anything
+    bool changed(GLStateKind kind, GLuint& current, GLuint value)
+    {
+        if (current == value)
+        {
+            counters.elided[kind]++;
+            return false;
+        }
+        counters.issued[kind]++;
+        current = value;
+        return true;
+    }
+
+    static int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:           return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:   return 1;
+        case GL_UNIFORM_BUFFER:         return 2;
+        case GL_PIXEL_UNPACK_BUFFER:    return 3;
+        case GL_PIXEL_PACK_BUFFER:      return 4;
+        case GL_COPY_WRITE_BUFFER:      return 5;
+        case GL_SHADER_STORAGE_BUFFER:  return 6;
+        default:                        return -1;
+        }
+    }
+    static int textureSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:       return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        default:                  return -1;
+        }
+    }
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_DEPTH_TEST:   return 0;
+        case GL_BLEND:        return 1;
+        case GL_CULL_FACE:    return 2;
+        case GL_SCISSOR_TEST: return 3;
+        case GL_STENCIL_TEST: return 4;
+        default:              return -1;
+        }
+    }
+};
+
+// the cache for the (single) GL context of the application
+inline GLStateCache& glState()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// GPU timing of named render passes with GL_TIMESTAMP queries (core since 3.3).
+// Every pass records a timestamp at its start and end; the queries of a frame are only read
+// back frameLatency frames later, so the results are normally there already and reading them
+// never stalls the pipeline. Should a frame still be pending by the time its ring slot is
+// reused, its results are dropped rather than waited for.
+// Timestamps (unlike GL_TIME_ELAPSED queries) may nest, so passes can contain passes.
+class GpuProfiler
+{
+public:
+    struct PassStats
+    {
+        size_t samples = 0;
+        double min = 0.0;   // milliseconds
+        double avg = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // history: how many of the most recent samples per pass the statistics cover
+    GpuProfiler(unsigned int frameLatency = 4, size_t history = 240)
+        : history(history), frameIndex(0), droppedFrames(0), enabled(true)
+    {
+        frames.resize(std::max(2u, frameLatency));
+    }
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (!enabled)
+            return;
+        Frame& frame = frames[frameIndex % frames.size()];
+        collect(frame);
+        frame.used = 0;
+        frame.records.clear();
+        begin("frame");
+    }
+    void endFrame()
+    {
+        if (!enabled)
+            return;
+        end();
+        frameIndex++;
+    }
+
+    // open / close a pass; passes are identified by name (string literals are fine)
+    // ------------------------------------------------------------------------
+    void begin(const char* name)
+    {
+        if (!enabled)
+            return;
+        Frame& frame = frames[frameIndex % frames.size()];
+        Record record;
+        record.pass = passIndex(name);
+        record.begin = frame.query();
+        record.end = 0;
+        glQueryCounter(record.begin, GL_TIMESTAMP);
+        open.push_back(frame.records.size());
+        frame.records.push_back(record);
+    }
+    void end()
+    {
+        if (!enabled || open.empty())
+            return;
+        Frame& frame = frames[frameIndex % frames.size()];
+        Record& record = frame.records[open.back()];
+        open.pop_back();
+        record.end = frame.query();
+        glQueryCounter(record.end, GL_TIMESTAMP);
+    }
+
+    // ------------------------------------------------------------------------
+    PassStats stats(const char* name) const
+    {
+        for (const Pass& pass : passes)
+            if (pass.name == name)
+                return summarize(pass);
+        return PassStats();
+    }
+    void print(std::ostream& out) const
+    {
+        out << "gpu pass              min ms   avg ms   p99 ms   (" << droppedFrames << " frames dropped)" << std::endl;
+        for (const Pass& pass : passes)
+        {
+            PassStats s = summarize(pass);
+            char line[128];
+            std::snprintf(line, sizeof(line), "  %-18s %8.3f %8.3f %8.3f", pass.name.c_str(), s.min, s.avg, s.p99);
+            out << line << std::endl;
+        }
+    }
+    // one row per pass: pass,samples,min_ms,avg_ms,p99_ms,max_ms
+    bool writeCsv(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "pass,samples,min_ms,avg_ms,p99_ms,max_ms\n";
+        for (const Pass& pass : passes)
+        {
+            PassStats s = summarize(pass);
+            file << pass.name << "," << s.samples << "," << s.min << "," << s.avg << "," << s.p99 << "," << s.max << "\n";
+        }
+        return (bool)file;
+    }
+
+    void setEnabled(bool value)
+    {
+        enabled = value;
+    }
+    void release()
+    {
+        for (Frame& frame : frames)
+        {
+            if (!frame.pool.empty())
+                glDeleteQueries((GLsizei)frame.pool.size(), frame.pool.data());
+            frame.pool.clear();
+            frame.records.clear();
+        }
+    }
+
+private:
+    struct Record
+    {
+        size_t pass;
+        GLuint begin;
+        GLuint end;
+    };
+    // the queries issued during one frame; the pool only grows
+    struct Frame
+    {
+        std::vector<GLuint> pool;
+        size_t used = 0;
+        std::vector<Record> records;
+
+        GLuint query()
+        {
+            if (used == pool.size())
+            {
+                GLuint id;
+                glGenQueries(1, &id);
+                pool.push_back(id);
+            }
+            return pool[used++];
+        }
+    };
+    struct Pass
+    {
+        std::string name;
+        std::vector<double> samples;  // ring of the last `history` durations in ms
+        size_t next = 0;
+    };
+
+    std::vector<Frame> frames;
+    std::vector<Pass> passes;
+    std::vector<size_t> open;  // records of the current frame still waiting for end()
+    size_t history;
+    unsigned long long frameIndex;
+    unsigned long long droppedFrames;
+    bool enabled;
+
+    size_t passIndex(const char* name)
+    {
+        for (size_t i = 0; i < passes.size(); i++)
+            if (std::strcmp(passes[i].name.c_str(), name) == 0)
+                return i;
+        passes.push_back(Pass());
+        passes.back().name = name;
+        return passes.size() - 1;
+    }
+
+    // read back a finished frame; it is complete once its last query is
+    void collect(Frame& frame)
+    {
+        if (frame.used == 0)
+            return;
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.pool[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            droppedFrames++;
+            return;
+        }
+        for (const Record& record : frame.records)
+        {
+            if (record.end == 0)
+                continue;
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(record.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(record.end, GL_QUERY_RESULT, &end);
+            Pass& pass = passes[record.pass];
+            double ms = (end - begin) / 1e6;
+            if (pass.samples.size() < history)
+                pass.samples.push_back(ms);
+            else
+                pass.samples[pass.next] = ms;
+            pass.next = (pass.next + 1) % history;
+        }
+    }
+
+    static PassStats summarize(const Pass& pass)
+    {
+        PassStats s;
+        s.samples = pass.samples.size();
+        if (s.samples == 0)
+            return s;
+        std::vector<double> sorted = pass.samples;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double sample : sorted)
+            sum += sample;
+        s.min = sorted.front();
+        s.max = sorted.back();
+        s.avg = sum / s.samples;
+        s.p99 = sorted[std::min(s.samples - 1, (size_t)(s.samples * 0.99))];
+        return s;
+    }
+};
+
+// scoped pass: GpuZone zone(profiler, "lamp");
+class GpuZone
+{
+public:
+    GpuZone(GpuProfiler& profiler, const char* name)
+        : profiler(profiler)
+    {
+        profiler.begin(name);
+    }
+    ~GpuZone()
+    {
+        profiler.end();
+    }
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    GpuProfiler& profiler;
+};
+#endif
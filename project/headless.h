@@ -0,0 +1,259 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <C:\glfw-3.3.8\include\GLFW\glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\camera.h>
+
+// Headless rendering for benchmarks on machines without a display: a GL 3.3 core context with
+// no window (EGL on Linux: surfaceless when the driver allows it, else a 1x1 pbuffer; Mesa's
+// llvmpipe works without any GPU), an offscreen framebuffer to render into, a scripted camera
+// path and frame time statistics. Where EGL is not available a hidden GLFW window provides the
+// context instead, so the mode works everywhere; it then just needs a display.
+
+#if defined(__linux__) && __has_include(<EGL/egl.h>)
+#define HEADLESS_EGL 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#define HEADLESS_EGL 0
+#endif
+
+class HeadlessContext
+{
+public:
+    HeadlessContext()
+        : window(NULL)
+#if HEADLESS_EGL
+        , display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), surface(EGL_NO_SURFACE)
+#endif
+    {
+    }
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // create the context and make it current; false if neither EGL nor GLFW could
+    // ------------------------------------------------------------------------
+    bool create()
+    {
+#if HEADLESS_EGL
+        if (createEgl())
+            return true;
+        std::cout << "headless: no EGL context, falling back to a hidden GLFW window" << std::endl;
+#endif
+        if (!glfwInit())
+            return false;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(64, 64, "LearnOpenGL (headless)", NULL, NULL);
+        if (window == NULL)
+        {
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(0);
+        return true;
+    }
+
+    // function pointer loader for glad / loadGLExtensions
+    GLADloadproc loader() const
+    {
+#if HEADLESS_EGL
+        if (context != EGL_NO_CONTEXT)
+            return (GLADloadproc)eglGetProcAddress;
+#endif
+        return (GLADloadproc)glfwGetProcAddress;
+    }
+    const char* backend() const
+    {
+#if HEADLESS_EGL
+        if (window == NULL)
+            return surface == EGL_NO_SURFACE ? "EGL surfaceless" : "EGL pbuffer";
+#endif
+        return "hidden GLFW window";
+    }
+
+    void destroy()
+    {
+#if HEADLESS_EGL
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (surface != EGL_NO_SURFACE)
+                eglDestroySurface(display, surface);
+            if (context != EGL_NO_CONTEXT)
+                eglDestroyContext(display, context);
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+            context = EGL_NO_CONTEXT;
+            surface = EGL_NO_SURFACE;
+        }
+#endif
+        if (window)
+        {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            window = NULL;
+        }
+    }
+
+private:
+    GLFWwindow* window;
+#if HEADLESS_EGL
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;
+
+    bool createEgl()
+    {
+        // prefer Mesa's surfaceless platform: no X11/Wayland and no GPU device needed
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay)
+                display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool noSurface = extensions && std::strstr(extensions, "EGL_KHR_surfaceless_context");
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, noSurface ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+            EGL_NONE };
+        EGLConfig config;
+        EGLint configCount = 0;
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE };
+        if (eglBindAPI(EGL_OPENGL_API) && eglChooseConfig(display, configAttributes, &config, 1, &configCount) && configCount > 0)
+            context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context != EGL_NO_CONTEXT && !noSurface)
+        {
+            const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        }
+        if (context == EGL_NO_CONTEXT || (!noSurface && surface == EGL_NO_SURFACE) || !eglMakeCurrent(display, surface, surface, context))
+        {
+            destroy();
+            return false;
+        }
+        return true;
+    }
+#endif
+};
+
+// offscreen colour + depth target the headless frames are rendered into
+// ------------------------------------------------------------------------
+class RenderTarget
+{
+public:
+    unsigned int framebuffer = 0;
+    unsigned int color = 0;
+    unsigned int depth = 0;
+    int width = 0;
+    int height = 0;
+
+    bool create(int targetWidth, int targetHeight)
+    {
+        width = targetWidth;
+        height = targetHeight;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glViewport(0, 0, width, height);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    // FNV-1a over the RGBA8 pixels: identical frames give identical hashes on the same driver
+    uint64_t hash() const
+    {
+        std::vector<unsigned char> pixels((size_t)width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        uint64_t value = 14695981039346656037ull;
+        for (unsigned char byte : pixels)
+            value = (value ^ byte) * 1099511628211ull;
+        return value;
+    }
+
+    void release()
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+    }
+};
+
+// scripted camera: one orbit around the scene per `period` seconds, bobbing up and down,
+// always looking at the origin. Driven by simulated time, so every run sees the same frames.
+// ------------------------------------------------------------------------
+inline void followCameraPath(Camera& camera, float time, float radius = 4.0f, float period = 10.0f)
+{
+    float angle = 6.2831853f * time / period;
+    camera.Position = glm::vec3(std::sin(angle) * radius, 1.0f + 0.75f * std::sin(2.0f * angle), std::cos(angle) * radius);
+    glm::vec3 direction = glm::normalize(-camera.Position);
+    camera.Yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    camera.Pitch = glm::degrees(std::asin(direction.y));
+    camera.ProcessMouseMovement(0.0f, 0.0f);  // recompute Front/Right/Up from Yaw and Pitch
+}
+
+// frame time percentiles in milliseconds
+// ------------------------------------------------------------------------
+struct FrameTimeReport
+{
+    double min = 0.0, p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0;
+
+    static FrameTimeReport from(std::vector<double> samples)
+    {
+        FrameTimeReport report;
+        if (samples.empty())
+            return report;
+        std::sort(samples.begin(), samples.end());
+        // nearest rank: the smallest sample with at least p of all samples at or below it
+        auto percentile = [&](double p) { return samples[std::max((size_t)1, (size_t)std::ceil(p * samples.size())) - 1]; };
+        double sum = 0.0;
+        for (double sample : samples)
+            sum += sample;
+        report.min = samples.front();
+        report.p50 = percentile(0.50);
+        report.p90 = percentile(0.90);
+        report.p99 = percentile(0.99);
+        report.max = samples.back();
+        report.mean = sum / samples.size();
+        return report;
+    }
+};
+#endif
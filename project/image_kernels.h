@@ -0,0 +1,506 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU image kernels shared by the runtime texture loader and the offline bake (texbake):
+// RGB -> RGBA expansion, channel extraction, premultiplied alpha and mip downsampling
+// (2x2 box or Kaiser-windowed sinc) done in linear space for sRGB colour data.
+// Every kernel has a scalar version; the SIMD paths, picked at runtime, are:
+//  - RGB -> RGBA, channel extraction, premultiplied alpha: SSSE3 and AVX2
+//  - box downsample: AVX2 (SSSE3 machines run the scalar version)
+//  - Kaiser downsample: one SSSE3-targeted tap accumulation, used at the SSSE3 and AVX2 levels
+// All paths produce bit-identical results (texbake --bench checks and times them).
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMAGE_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define IMAGE_TARGET_SSSE3
+#define IMAGE_TARGET_AVX2
+#else
+#define IMAGE_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define IMAGE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define IMAGE_KERNELS_X86 0
+#endif
+
+enum ImageKernelLevel
+{
+    IMAGE_KERNELS_SCALAR,
+    IMAGE_KERNELS_SSSE3,
+    IMAGE_KERNELS_AVX2,
+};
+
+inline const char* imageKernelLevelName(ImageKernelLevel level)
+{
+    return level == IMAGE_KERNELS_AVX2 ? "avx2" : level == IMAGE_KERNELS_SSSE3 ? "ssse3" : "scalar";
+}
+
+// the best level this CPU (and OS, for the AVX registers) supports
+// ------------------------------------------------------------------------
+inline ImageKernelLevel detectImageKernelLevel()
+{
+#if IMAGE_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool ssse3 = (regs[2] & (1 << 9)) != 0;
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx2 = false;
+    if (osxsave && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(regs, 7, 0);
+        avx2 = (regs[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return IMAGE_KERNELS_AVX2;
+    if (ssse3)
+        return IMAGE_KERNELS_SSSE3;
+#endif
+    return IMAGE_KERNELS_SCALAR;
+}
+
+// level used by the kernels; lowered by benchmarks to time the fallbacks
+inline ImageKernelLevel& imageKernelLevel()
+{
+    static ImageKernelLevel level = detectImageKernelLevel();
+    return level;
+}
+
+// sRGB transfer tables
+// ------------------------------------------------------------------------
+const int SRGB_ENCODE_STEPS = 8192;
+
+struct SrgbTables
+{
+    float toLinear[512];                        // [0, 256): sRGB byte -> linear, [256, 512): byte / 255 for linear data
+    int32_t toSrgb[SRGB_ENCODE_STEPS + 1];      // linear * SRGB_ENCODE_STEPS -> sRGB byte
+};
+
+inline const SrgbTables& srgbTables()
+{
+    static const SrgbTables* tables = []
+    {
+        SrgbTables* t = new SrgbTables();
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            t->toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            t->toLinear[256 + i] = c;
+        }
+        for (int i = 0; i <= SRGB_ENCODE_STEPS; i++)
+        {
+            float l = (float)i / SRGB_ENCODE_STEPS;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            t->toSrgb[i] = (int32_t)(c * 255.0f + 0.5f);
+        }
+        return t;
+    }();
+    return *tables;
+}
+
+// encode one linear value in [0, 1]; alpha and linear data are stored as value * 255
+inline uint8_t encodeChannel(float value, bool srgb)
+{
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    if (srgb)
+        return (uint8_t)srgbTables().toSrgb[(int)(value * SRGB_ENCODE_STEPS + 0.5f)];
+    return (uint8_t)(int)(value * 255.0f + 0.5f);
+}
+
+// ------------------------------------------------------------------------
+// RGB -> RGBA (alpha 255)
+// ------------------------------------------------------------------------
+inline void expandRgbToRgbaScalar(const uint8_t* rgb, uint8_t* rgba, size_t begin, size_t pixels)
+{
+    for (size_t i = begin; i < pixels; i++)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+#if IMAGE_KERNELS_X86
+IMAGE_TARGET_SSSE3 inline size_t expandRgbToRgbaSsse3(const uint8_t* rgb, uint8_t* rgba, size_t pixels)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    for (; i + 6 <= pixels; i += 4)  // 16 byte loads for 12 bytes of input: keep two pixels of slack
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(_mm_shuffle_epi8(source, shuffle), alpha));
+    }
+    return i;
+}
+
+IMAGE_TARGET_AVX2 inline size_t expandRgbToRgbaAvx2(const uint8_t* rgb, uint8_t* rgba, size_t pixels)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    for (; i + 10 <= pixels; i += 8)  // the upper lane loads 16 bytes from pixel i + 4
+    {
+        __m128i low = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+        __m128i high = _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 12));
+        __m256i source = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(source, shuffle), alpha));
+    }
+    return i;
+}
+#endif
+
+inline void imageExpandRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixels)
+{
+    size_t done = 0;
+#if IMAGE_KERNELS_X86
+    if (imageKernelLevel() == IMAGE_KERNELS_AVX2)
+        done = expandRgbToRgbaAvx2(rgb, rgba, pixels);
+    else if (imageKernelLevel() == IMAGE_KERNELS_SSSE3)
+        done = expandRgbToRgbaSsse3(rgb, rgba, pixels);
+#endif
+    expandRgbToRgbaScalar(rgb, rgba, done, pixels);
+}
+
+// ------------------------------------------------------------------------
+// extract one channel of an RGBA image (e.g. a specular mask)
+// ------------------------------------------------------------------------
+inline void extractChannelScalar(const uint8_t* rgba, uint8_t* out, size_t begin, size_t pixels, int channel)
+{
+    for (size_t i = begin; i < pixels; i++)
+        out[i] = rgba[i * 4 + channel];
+}
+
+#if IMAGE_KERNELS_X86
+// shuffle mask moving channel c of four pixels to bytes [4 * slot, 4 * slot + 4)
+IMAGE_TARGET_SSSE3 inline __m128i channelGatherMask(int channel, int slot)
+{
+    alignas(16) int8_t mask[16];
+    for (int b = 0; b < 16; b++)
+        mask[b] = (b / 4 == slot) ? (int8_t)((b % 4) * 4 + channel) : (int8_t)-1;
+    return _mm_load_si128((const __m128i*)mask);
+}
+
+IMAGE_TARGET_SSSE3 inline size_t extractChannelSsse3(const uint8_t* rgba, uint8_t* out, size_t pixels, int channel)
+{
+    const __m128i m0 = channelGatherMask(channel, 0), m1 = channelGatherMask(channel, 1);
+    const __m128i m2 = channelGatherMask(channel, 2), m3 = channelGatherMask(channel, 3);
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const __m128i* source = (const __m128i*)(rgba + i * 4);
+        __m128i result = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(source + 0), m0), _mm_shuffle_epi8(_mm_loadu_si128(source + 1), m1)),
+            _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(source + 2), m2), _mm_shuffle_epi8(_mm_loadu_si128(source + 3), m3)));
+        _mm_storeu_si128((__m128i*)(out + i), result);
+    }
+    return i;
+}
+
+IMAGE_TARGET_AVX2 inline size_t extractChannelAvx2(const uint8_t* rgba, uint8_t* out, size_t pixels, int channel)
+{
+    const __m256i m0 = _mm256_broadcastsi128_si256(channelGatherMask(channel, 0));
+    const __m256i m1 = _mm256_broadcastsi128_si256(channelGatherMask(channel, 1));
+    const __m256i m2 = _mm256_broadcastsi128_si256(channelGatherMask(channel, 2));
+    const __m256i m3 = _mm256_broadcastsi128_si256(channelGatherMask(channel, 3));
+    // each lane gathers its own four pixels; this restores pixel order across the lanes
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= pixels; i += 32)
+    {
+        const __m256i* source = (const __m256i*)(rgba + i * 4);
+        __m256i result = _mm256_or_si256(
+            _mm256_or_si256(_mm256_shuffle_epi8(_mm256_loadu_si256(source + 0), m0), _mm256_shuffle_epi8(_mm256_loadu_si256(source + 1), m1)),
+            _mm256_or_si256(_mm256_shuffle_epi8(_mm256_loadu_si256(source + 2), m2), _mm256_shuffle_epi8(_mm256_loadu_si256(source + 3), m3)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permutevar8x32_epi32(result, order));
+    }
+    return i;
+}
+#endif
+
+inline void imageExtractChannel(const uint8_t* rgba, uint8_t* out, size_t pixels, int channel)
+{
+    size_t done = 0;
+#if IMAGE_KERNELS_X86
+    if (imageKernelLevel() == IMAGE_KERNELS_AVX2)
+        done = extractChannelAvx2(rgba, out, pixels, channel);
+    else if (imageKernelLevel() == IMAGE_KERNELS_SSSE3)
+        done = extractChannelSsse3(rgba, out, pixels, channel);
+#endif
+    extractChannelScalar(rgba, out, done, pixels, channel);
+}
+
+// ------------------------------------------------------------------------
+// premultiplied alpha: rgb = round(rgb * a / 255), in place
+// ------------------------------------------------------------------------
+inline void premultiplyAlphaScalar(uint8_t* rgba, size_t begin, size_t pixels)
+{
+    for (size_t i = begin; i < pixels; i++)
+    {
+        unsigned int alpha = rgba[i * 4 + 3];
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int t = rgba[i * 4 + c] * alpha + 128;
+            rgba[i * 4 + c] = (uint8_t)((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+#if IMAGE_KERNELS_X86
+// 16 bit lanes: rgb * alpha, alpha * 255, then the same exact divide by 255 as the scalar code
+IMAGE_TARGET_SSSE3 inline __m128i premultiplyHalf(__m128i pixels16)
+{
+    const __m128i alphaSlot = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_or_si128(_mm_andnot_si128(alphaSlot, alpha), _mm_and_si128(alphaSlot, _mm_set1_epi16(255)));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels16, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+IMAGE_TARGET_SSSE3 inline size_t premultiplyAlphaSsse3(uint8_t* rgba, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i low = premultiplyHalf(_mm_unpacklo_epi8(source, zero));
+        __m128i high = premultiplyHalf(_mm_unpackhi_epi8(source, zero));
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(low, high));
+    }
+    return i;
+}
+
+IMAGE_TARGET_AVX2 inline __m256i premultiplyHalfAvx2(__m256i pixels16)
+{
+    const __m256i alphaSlot = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm256_or_si256(_mm256_andnot_si256(alphaSlot, alpha), _mm256_and_si256(alphaSlot, _mm256_set1_epi16(255)));
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(pixels16, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+IMAGE_TARGET_AVX2 inline size_t premultiplyAlphaAvx2(uint8_t* rgba, size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i source = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+        __m256i low = premultiplyHalfAvx2(_mm256_unpacklo_epi8(source, zero));
+        __m256i high = premultiplyHalfAvx2(_mm256_unpackhi_epi8(source, zero));
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_packus_epi16(low, high));  // unpack and pack both stay within lanes
+    }
+    return i;
+}
+#endif
+
+inline void imagePremultiplyAlpha(uint8_t* rgba, size_t pixels)
+{
+    size_t done = 0;
+#if IMAGE_KERNELS_X86
+    if (imageKernelLevel() == IMAGE_KERNELS_AVX2)
+        done = premultiplyAlphaAvx2(rgba, pixels);
+    else if (imageKernelLevel() == IMAGE_KERNELS_SSSE3)
+        done = premultiplyAlphaSsse3(rgba, pixels);
+#endif
+    premultiplyAlphaScalar(rgba, done, pixels);
+}
+
+// ------------------------------------------------------------------------
+// 2x2 box downsample of an RGBA8 image into max(1, width / 2) x max(1, height / 2).
+// Colour channels of sRGB data are averaged in linear space, alpha always linearly.
+// The last row/column is repeated for odd sizes.
+// ------------------------------------------------------------------------
+inline void downsampleBoxScalar(const uint8_t* source, int width, int height, uint8_t* destination, bool srgb, int y, int beginX)
+{
+    const SrgbTables& tables = srgbTables();
+    int outWidth = std::max(1, width / 2);
+    const uint8_t* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+    const uint8_t* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+    for (int x = beginX; x < outWidth; x++)
+    {
+        int x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+        for (int c = 0; c < 4; c++)
+        {
+            bool encode = srgb && c < 3;
+            int offset = encode ? 0 : 256;
+            float sum = (tables.toLinear[offset + row0[x0 + c]] + tables.toLinear[offset + row1[x0 + c]]) +
+                        (tables.toLinear[offset + row0[x1 + c]] + tables.toLinear[offset + row1[x1 + c]]);
+            destination[((size_t)y * outWidth + x) * 4 + c] = encodeChannel(sum * 0.25f, encode);
+        }
+    }
+}
+
+#if IMAGE_KERNELS_X86
+IMAGE_TARGET_AVX2 inline __m256 decodeTwoPixels(const uint8_t* pixels, __m256i tableOffset)
+{
+    __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)pixels)), tableOffset);
+    return _mm256_i32gather_ps(srgbTables().toLinear, index, 4);
+}
+
+// two output pixels per iteration: decode through a gather from the transfer table, sum, encode through a second gather
+IMAGE_TARGET_AVX2 inline int downsampleBoxAvx2(const uint8_t* source, int width, int height, uint8_t* destination, bool srgb, int y)
+{
+    const SrgbTables& tables = srgbTables();
+    int outWidth = std::max(1, width / 2);
+    const uint8_t* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+    const uint8_t* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+    const __m256i tableOffset = srgb ? _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256) : _mm256_set1_epi32(256);
+    const __m256 quarter = _mm256_set1_ps(0.25f), zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 srgbScale = _mm256_set1_ps((float)SRGB_ENCODE_STEPS), linearScale = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+    int x = 0;
+    for (; x + 2 <= outWidth && x * 2 + 4 <= width; x += 2)
+    {
+        // a / b: source pixels 2x, 2x+1 / 2x+2, 2x+3 of both rows, summed per column pair
+        __m256 a = _mm256_add_ps(decodeTwoPixels(row0 + x * 8, tableOffset), decodeTwoPixels(row1 + x * 8, tableOffset));
+        __m256 b = _mm256_add_ps(decodeTwoPixels(row0 + x * 8 + 8, tableOffset), decodeTwoPixels(row1 + x * 8 + 8, tableOffset));
+        __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+        __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(sum, quarter), zero), one);
+
+        __m256i linear = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, linearScale), half));
+        __m256i result = linear;
+        if (srgb)
+        {
+            __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, srgbScale), half));
+            result = _mm256_blend_epi32(_mm256_i32gather_epi32(tables.toSrgb, index, 4), linear, 0x88);
+        }
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(result, result), _mm256_setzero_si256());
+        uint32_t* out = (uint32_t*)(destination + ((size_t)y * outWidth + x) * 4);
+        out[0] = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+        out[1] = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+    }
+    return x;
+}
+#endif
+
+inline void imageDownsampleBox(const uint8_t* source, int width, int height, uint8_t* destination, bool srgb)
+{
+    int outHeight = std::max(1, height / 2);
+    for (int y = 0; y < outHeight; y++)
+    {
+        int done = 0;
+#if IMAGE_KERNELS_X86
+        if (imageKernelLevel() == IMAGE_KERNELS_AVX2)
+            done = downsampleBoxAvx2(source, width, height, destination, srgb, y);
+#endif
+        downsampleBoxScalar(source, width, height, destination, srgb, y, done);
+    }
+}
+
+// ------------------------------------------------------------------------
+// Kaiser-windowed sinc downsample (alpha 4, 6 taps per axis), separable, in linear space.
+// Sharper than the box filter without its aliasing; negative lobes are clamped on encode.
+// ------------------------------------------------------------------------
+inline const float* kaiserWeights()
+{
+    static const float* weights = []
+    {
+        auto besselI0 = [](float x)
+        {
+            float sum = 1.0f, term = 1.0f;
+            for (int k = 1; k < 20; k++)
+            {
+                term *= (x / (2.0f * k)) * (x / (2.0f * k));
+                sum += term;
+            }
+            return sum;
+        };
+        static float taps[6];
+        const float alpha = 4.0f, radius = 1.5f, pi = 3.14159265358979f;
+        float total = 0.0f;
+        for (int tap = 0; tap < 6; tap++)
+        {
+            // source pixel 2x - 2 + tap sits (tap - 2.5) source pixels = (tap - 2.5) / 2 output pixels from the centre
+            float t = (tap - 2.5f) / 2.0f;
+            float sinc = std::sin(pi * t) / (pi * t);
+            float ratio = t / radius;
+            taps[tap] = sinc * besselI0(alpha * std::sqrt(1.0f - ratio * ratio)) / besselI0(alpha);
+            total += taps[tap];
+        }
+        for (int tap = 0; tap < 6; tap++)
+            taps[tap] /= total;
+        return (const float*)taps;
+    }();
+    return weights;
+}
+
+// one RGBA float pixel = one 4 wide accumulation; the SIMD path only changes how that sum is computed.
+// it only needs SSE, but carries the SSSE3 target so 32-bit builds without -msse compile it too
+#if IMAGE_KERNELS_X86
+IMAGE_TARGET_SSSE3 inline void accumulateTapsSsse3(const float* const* taps, const float* weights, float* out)
+{
+    __m128 sum = _mm_setzero_ps();
+    for (int tap = 0; tap < 6; tap++)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(taps[tap]), _mm_set1_ps(weights[tap])));
+    _mm_storeu_ps(out, sum);
+}
+#endif
+
+inline void accumulateTaps(const float* const* taps, const float* weights, float* out)
+{
+#if IMAGE_KERNELS_X86
+    if (imageKernelLevel() != IMAGE_KERNELS_SCALAR)
+    {
+        accumulateTapsSsse3(taps, weights, out);
+        return;
+    }
+#endif
+    for (int c = 0; c < 4; c++)
+    {
+        float sum = 0.0f;
+        for (int tap = 0; tap < 6; tap++)
+            sum = sum + taps[tap][c] * weights[tap];
+        out[c] = sum;
+    }
+}
+
+inline void imageDownsampleKaiser(const uint8_t* source, int width, int height, uint8_t* destination, bool srgb)
+{
+    const SrgbTables& tables = srgbTables();
+    const float* weights = kaiserWeights();
+    int outWidth = std::max(1, width / 2), outHeight = std::max(1, height / 2);
+
+    std::vector<float> linear((size_t)width * height * 4);
+    for (size_t i = 0; i < linear.size(); i++)
+        linear[i] = tables.toLinear[(srgb && i % 4 != 3 ? 0 : 256) + source[i]];
+
+    // horizontal pass: width -> outWidth (a 1 pixel wide image just copies: every tap clamps to it)
+    std::vector<float> horizontal((size_t)outWidth * height * 4);
+    const float* taps[6];
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < outWidth; x++)
+        {
+            for (int tap = 0; tap < 6; tap++)
+                taps[tap] = &linear[((size_t)y * width + std::min(std::max(x * 2 - 2 + tap, 0), width - 1)) * 4];
+            accumulateTaps(taps, weights, &horizontal[((size_t)y * outWidth + x) * 4]);
+        }
+
+    // vertical pass: height -> outHeight, then encode
+    float pixel[4];
+    for (int y = 0; y < outHeight; y++)
+        for (int x = 0; x < outWidth; x++)
+        {
+            for (int tap = 0; tap < 6; tap++)
+                taps[tap] = &horizontal[((size_t)std::min(std::max(y * 2 - 2 + tap, 0), height - 1) * outWidth + x) * 4];
+            accumulateTaps(taps, weights, pixel);
+            for (int c = 0; c < 4; c++)
+                destination[((size_t)y * outWidth + x) * 4 + c] = encodeChannel(pixel[c], srgb && c < 3);
+        }
+}
+#endif
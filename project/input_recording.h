@@ -0,0 +1,175 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Capture and replay of the input stream, so two runs (or two builds) see exactly the same
+// camera path and shader time.
+//
+// A recording is a small header followed by one record per frame, in the order the render
+// loop consumes them: the frame's timestamp, the movement keys held when processInput ran,
+// and the mouse / scroll events glfwPollEvents delivered at the end of that frame. Replaying
+// feeds the same values through the same code paths, so the camera ends up bit-identical.
+// Events are packed (1 byte type + 2 floats) and stored little-endian, as written on x86.
+
+const uint32_t INPUT_RECORDING_MAGIC = 0x52494C47;  // "GLIR"
+const uint32_t INPUT_RECORDING_VERSION = 1;
+
+enum InputKey : uint8_t
+{
+    INPUT_KEY_FORWARD = 1 << 0,
+    INPUT_KEY_BACKWARD = 1 << 1,
+    INPUT_KEY_LEFT = 1 << 2,
+    INPUT_KEY_RIGHT = 1 << 3,
+    INPUT_KEY_EXIT = 1 << 4,
+    INPUT_KEY_PICK = 1 << 5   // left mouse button
+};
+
+enum InputEventType : uint8_t
+{
+    INPUT_EVENT_MOUSE = 0,   // cursor position x, y
+    INPUT_EVENT_SCROLL = 1   // scroll offset x, y
+};
+
+struct InputEvent
+{
+    InputEventType type;
+    float x;
+    float y;
+};
+
+struct InputFrame
+{
+    float time = 0.0f;      // seconds since start, as the render loop saw it
+    uint8_t keys = 0;       // InputKey bits
+    std::vector<InputEvent> events;
+};
+
+// writes frames as they complete; events are buffered until endFrame
+// ------------------------------------------------------------------------
+class InputRecorder
+{
+public:
+    bool open(const std::string& recordingPath)
+    {
+        path = recordingPath;
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        write(INPUT_RECORDING_MAGIC);
+        write(INPUT_RECORDING_VERSION);
+        frames = 0;
+        return true;
+    }
+    bool recording() const { return file.is_open(); }
+
+    void event(InputEventType type, float x, float y)
+    {
+        if (recording())
+            current.events.push_back({ type, x, y });
+    }
+    void setKeys(uint8_t keys)
+    {
+        current.keys = keys;
+    }
+
+    // frame record: float time, uint8 keys, uint16 event count, events
+    void endFrame(float time)
+    {
+        if (!recording())
+            return;
+        write(time);
+        write(current.keys);
+        write((uint16_t)current.events.size());
+        for (const InputEvent& event : current.events)
+        {
+            write(event.type);
+            write(event.x);
+            write(event.y);
+        }
+        current.events.clear();
+        frames++;
+    }
+
+    void close()
+    {
+        if (!recording())
+            return;
+        file.close();
+        std::cout << "input: recorded " << frames << " frames to " << path << std::endl;
+    }
+
+private:
+    std::ofstream file;
+    std::string path;
+    InputFrame current;
+    unsigned int frames = 0;
+
+    template <typename T>
+    void write(T value)
+    {
+        file.write((const char*)&value, sizeof(value));
+    }
+};
+
+// reads a whole recording up front and hands it out frame by frame
+// ------------------------------------------------------------------------
+class InputReplay
+{
+public:
+    bool open(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        uint32_t magic = 0, version = 0;
+        if (!read(file, magic) || !read(file, version) || magic != INPUT_RECORDING_MAGIC || version != INPUT_RECORDING_VERSION)
+            return false;
+
+        InputFrame frame;
+        uint16_t eventCount = 0;
+        while (read(file, frame.time) && read(file, frame.keys) && read(file, eventCount))
+        {
+            frame.events.resize(eventCount);
+            for (InputEvent& event : frame.events)
+            {
+                if (!read(file, event.type) || !read(file, event.x) || !read(file, event.y))
+                {
+                    frames.clear();
+                    return false;
+                }
+            }
+            frames.push_back(frame);
+        }
+        next = 0;
+        return !frames.empty();
+    }
+    // live input is ignored for the whole replay; finished once the last frame was handed out
+    bool replaying() const { return !frames.empty(); }
+    bool finished() const { return replaying() && next >= frames.size(); }
+    size_t frameCount() const { return frames.size(); }
+
+    // the next recorded frame; its time is replaced by frame * fixedStep when fixedStep > 0
+    const InputFrame& advance(float fixedStep)
+    {
+        InputFrame& frame = frames[next];
+        if (fixedStep > 0.0f)
+            frame.time = next * fixedStep;
+        next++;
+        return frame;
+    }
+
+private:
+    std::vector<InputFrame> frames;
+    size_t next = 0;
+
+    template <typename T>
+    static bool read(std::ifstream& file, T& value)
+    {
+        return (bool)file.read((char*)&value, sizeof(value));
+    }
+};
+
+#endif
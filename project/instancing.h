@@ -0,0 +1,86 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\transform.h>
+
+// per-instance vertex attributes: a mat4 takes four consecutive locations, a mat3 three
+const unsigned int INSTANCE_MODEL_LOCATION = 3;   // locations 3-6
+const unsigned int INSTANCE_NORMAL_LOCATION = 7;  // locations 7-9
+const unsigned int INSTANCE_MATERIAL_LOCATION = 10;  // uint, index into the material storage buffer
+
+// per-instance data read by shader_instanced.vs
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal;
+    uint32_t material;  // see material_system.h
+};
+
+inline InstanceData makeInstance(const glm::mat4& model, uint32_t material = 0)
+{
+    InstanceData instance;
+    instance.model = model;
+    instance.normal = normalMatrix(model);
+    instance.material = material;
+    return instance;
+}
+
+// vertex buffer holding one InstanceData per instance, advanced once per instance (divisor 1)
+class InstanceBuffer
+{
+public:
+    unsigned int ID;
+    unsigned int capacity;  // in instances
+    unsigned int count;
+
+    InstanceBuffer() : capacity(0), count(0)
+    {
+        glGenBuffers(1, &ID);
+    }
+
+    // add the per-instance attributes to a VAO that already holds the mesh attributes
+    // ------------------------------------------------------------------------
+    void attach(unsigned int vao) const
+    {
+        glState().bindVertexArray(vao);
+        pointAttributes(0);
+        for (unsigned int location = INSTANCE_MODEL_LOCATION; location <= INSTANCE_MATERIAL_LOCATION; location++)
+        {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glState().bindVertexArray(0);
+    }
+
+    // make instance 0 of the bound VAO read element firstInstance of the buffer; this is how
+    // a draw starts part-way into the buffer when glDrawElementsInstancedBaseInstance is missing
+    void pointAttributes(unsigned int firstInstance) const
+    {
+        glState().bindBuffer(GL_ARRAY_BUFFER, ID);
+        size_t base = (size_t)firstInstance * sizeof(InstanceData);
+        for (unsigned int column = 0; column < 4; column++)
+            glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        for (unsigned int column = 0; column < 3; column++)
+            glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, normal) + column * sizeof(glm::vec3)));
+        glVertexAttribIPointer(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, material)));
+    }
+
+    // replace the contents; the old storage is orphaned so the driver never waits for draws still reading it
+    // ------------------------------------------------------------------------
+    void upload(const InstanceData* instances, unsigned int instanceCount)
+    {
+        glState().bindBuffer(GL_ARRAY_BUFFER, ID);
+        if (instanceCount > capacity)
+            capacity = instanceCount;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)instanceCount * sizeof(InstanceData), instances);
+        count = instanceCount;
+    }
+};
+#endif
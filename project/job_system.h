@@ -0,0 +1,420 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\cpu_profiler.h>
+
+// Work-stealing job scheduler shared by all CPU work off the GL calls: culling, animation and draw
+// recording every frame, file reads and texture decodes in the background.
+//
+// The thread that creates the system is thread 0 (the GL thread), the workers are 1..N-1. Every
+// thread owns a lock-free deque (Chase-Lev): it pushes and pops its own jobs at the bottom, newest
+// first, while a thread that runs out of work steals the oldest job from the top of another's. A job
+// can count down a JobCounter when it has run and can be held back until another counter reaches
+// zero; wait() keeps running jobs until its counter is done instead of blocking, so a job may wait
+// for the jobs it spawned.
+//
+// Next to the deques are two shared queues: background jobs (anything that can take milliseconds)
+// are only picked up by the workers, so the GL thread never gets stuck in a decode while it waits
+// for frame work; and main-thread jobs, which only ever run on the GL thread, in runMainThreadJobs()
+// or while it waits, for work that needs the context.
+
+enum JobQueue
+{
+    JOB_QUEUE_FRAME = 0,        // the work-stealing deques
+    JOB_QUEUE_BACKGROUND = 1,   // workers only (the GL thread too when there are no workers)
+    JOB_QUEUE_MAIN_THREAD = 2   // GL thread only
+};
+
+struct Job;
+
+// number of scheduled jobs that have not finished yet; jobs can be held back until it reaches zero.
+// A counter must outlive its jobs (JobSystem::wait() on it before destroying it) and can be reused
+// once it is done.
+class JobCounter
+{
+public:
+    JobCounter()
+        : pending(0)
+    {
+    }
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const
+    {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending;
+    std::mutex mutex;               // guards waiting
+    std::vector<Job*> waiting;      // jobs scheduled to run once pending reaches zero
+};
+
+struct Job
+{
+    std::function<void(unsigned int thread)> function;
+    JobCounter* counter;  // counted down after function has run, may be NULL
+    JobQueue queue;
+};
+
+// fixed size Chase-Lev deque: push()/pop() by the owning thread only, steal() by any thread
+// ------------------------------------------------------------------------
+class JobDeque
+{
+public:
+    static const int64_t CAPACITY = 4096;
+
+    JobDeque()
+        : top(0), bottom(0)
+    {
+        for (std::atomic<Job*>& slot : slots)
+            slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // false when full
+    bool push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        slots[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // the last job: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Job* job = slots[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Job*> slots[CAPACITY];
+};
+
+class JobSystem
+{
+public:
+    // threads: total threads running jobs, including the GL thread (0: one per core, at most 8)
+    JobSystem(unsigned int threads = 0)
+        : queued(0), sleepers(0), quit(false)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+        for (unsigned int i = 0; i < threads; i++)
+            deques.emplace_back(new JobDeque());
+        bindThread(0);
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back(&JobSystem::workerMain, this, i);
+    }
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+        // whatever is left never ran; its counters are not counted down
+        for (std::unique_ptr<JobDeque>& deque : deques)
+            while (Job* job = deque->pop())
+                delete job;
+        for (Job* job : background)
+            delete job;
+        for (Job* job : mainThread)
+            delete job;
+    }
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int threadCount() const
+    {
+        return (unsigned int)deques.size();
+    }
+    // index of the calling thread, UINT_MAX for threads outside the system
+    unsigned int currentThread() const
+    {
+        return threadOwner() == this ? threadIndex() : UINT_MAX;
+    }
+
+    // run function(thread) as a job; counter (if given) is counted up now and down once the job has
+    // run, and the job is held back until `after` (if given) is done. Frame jobs scheduled from a
+    // thread outside the system go to the background queue.
+    // ------------------------------------------------------------------------
+    void schedule(std::function<void(unsigned int thread)> function, JobCounter* counter = NULL, JobCounter* after = NULL, JobQueue queue = JOB_QUEUE_FRAME)
+    {
+        Job* job = new Job{ std::move(function), counter, queue };
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        if (after)
+        {
+            std::lock_guard<std::mutex> lock(after->mutex);
+            if (!after->done())
+            {
+                after->waiting.push_back(job);
+                return;
+            }
+        }
+        enqueue(job);
+    }
+
+    // run jobs until counter is done. On the GL thread this includes main-thread jobs, but only
+    // includes background jobs when there are no workers to run them.
+    // ------------------------------------------------------------------------
+    void wait(JobCounter& counter)
+    {
+        unsigned int thread = currentThread();
+        assert(thread != UINT_MAX && "JobSystem::wait() from a thread outside the system");
+        while (!counter.done())
+        {
+            if (Job* job = findJob(thread))
+                execute(job, thread);
+            else if (thread == 0 && runMainThreadJob())
+                continue;
+            else
+                std::this_thread::yield();
+        }
+        // the last job may still hold the counter's lock; after this the counter can be destroyed
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    // GL thread, once per frame: run the queued main-thread jobs. Without workers it also runs one
+    // background job, so background work still makes progress.
+    // ------------------------------------------------------------------------
+    void runMainThreadJobs()
+    {
+        assert(currentThread() == 0 && "main-thread jobs run on the thread that created the JobSystem");
+        std::vector<Job*> jobs;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            jobs.swap(mainThread);
+        }
+        for (Job* job : jobs)
+            execute(job, 0);
+        if (workers.empty())
+            if (Job* job = takeBackground())
+                execute(job, 0);
+    }
+
+    // run task(index, thread) for every index in [0, count) as frame jobs and wait for all of them
+    // ------------------------------------------------------------------------
+    void run(size_t count, const std::function<void(size_t task, unsigned int thread)>& task)
+    {
+        if (count == 0)
+            return;
+        unsigned int thread = currentThread();
+        if (count == 1 || workers.empty() || thread == UINT_MAX)
+        {
+            for (size_t i = 0; i < count; i++)
+                task(i, thread == UINT_MAX ? 0 : thread);
+            return;
+        }
+        JobCounter counter;
+        for (size_t i = 1; i < count; i++)
+            schedule([&task, i](unsigned int thread) { task(i, thread); }, &counter);
+        task(0, thread);
+        wait(counter);
+    }
+
+    // split [0, count) into about `perThread` chunks per thread of at least minChunk items each and
+    // run chunk(begin, end, thread) on them
+    // ------------------------------------------------------------------------
+    void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t begin, size_t end, unsigned int thread)>& chunk, unsigned int perThread = 4)
+    {
+        size_t chunks = std::max<size_t>(1, std::min<size_t>((size_t)threadCount() * perThread, count / std::max<size_t>(1, minChunk)));
+        size_t size = (count + chunks - 1) / chunks;
+        run(chunks, [&](size_t index, unsigned int thread)
+        {
+            size_t begin = index * size;
+            size_t end = std::min(count, begin + size);
+            if (begin < end)
+                chunk(begin, end, thread);
+        });
+    }
+
+private:
+    std::vector<std::unique_ptr<JobDeque>> deques;  // one per thread
+    std::vector<std::thread> workers;
+
+    std::mutex queueMutex;                  // guards background and mainThread
+    std::deque<Job*> background;
+    std::vector<Job*> mainThread;
+
+    std::atomic<int> queued;                // jobs in the deques and the background queue
+    std::atomic<int> sleepers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool quit;
+
+    static const JobSystem*& threadOwner()
+    {
+        thread_local const JobSystem* owner = NULL;
+        return owner;
+    }
+    static unsigned int& threadIndex()
+    {
+        thread_local unsigned int index = 0;
+        return index;
+    }
+    void bindThread(unsigned int thread)
+    {
+        threadOwner() = this;
+        threadIndex() = thread;
+    }
+
+    void enqueue(Job* job)
+    {
+        unsigned int thread = currentThread();
+        if (job->queue == JOB_QUEUE_MAIN_THREAD)
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            mainThread.push_back(job);
+            return;
+        }
+        if (job->queue == JOB_QUEUE_FRAME && thread != UINT_MAX)
+        {
+            if (!deques[thread]->push(job))
+            {
+                execute(job, thread);  // deque full: run it right here
+                return;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            background.push_back(job);
+        }
+        // a worker that is about to sleep either sees the job counted or is counted as a sleeper
+        queued.fetch_add(1);
+        if (sleepers.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    // own deque first, then steal from the others, then the background queue
+    Job* findJob(unsigned int thread)
+    {
+        Job* job = deques[thread]->pop();
+        for (unsigned int i = 1; job == nullptr && i < deques.size(); i++)
+            job = deques[(thread + i) % deques.size()]->steal();
+        if (job != nullptr)
+        {
+            queued.fetch_sub(1);
+            return job;
+        }
+        if (thread != 0 || workers.empty())
+            return takeBackground();
+        return nullptr;
+    }
+    Job* takeBackground()
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (background.empty())
+            return nullptr;
+        Job* job = background.front();
+        background.pop_front();
+        queued.fetch_sub(1);
+        return job;
+    }
+    bool runMainThreadJob()
+    {
+        Job* job;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (mainThread.empty())
+                return false;
+            job = mainThread.front();
+            mainThread.erase(mainThread.begin());
+        }
+        execute(job, 0);
+        return true;
+    }
+
+    void execute(Job* job, unsigned int thread)
+    {
+        job->function(thread);
+        JobCounter* counter = job->counter;
+        delete job;
+        if (counter == NULL)
+            return;
+        // counted down under the lock, so schedule() with the counter as `after` either sees it done
+        // or leaves its job in waiting before the list is released here
+        std::vector<Job*> released;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                released.swap(counter->waiting);
+        }
+        for (Job* waiting : released)
+            enqueue(waiting);
+    }
+
+    void workerMain(unsigned int thread)
+    {
+        bindThread(thread);
+        cpuProfiler().setThreadName("job worker");
+        for (;;)
+        {
+            if (Job* job = findJob(thread))
+            {
+                execute(job, thread);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1);
+            wake.wait(lock, [this] { return quit || queued.load() > 0; });
+            sleepers.fetch_sub(1);
+            if (quit)
+                return;
+        }
+    }
+};
+#endif
@@ -1,11 +1,11 @@
 #version 460 core
 layout(location = 0) in vec3 aPos;
+// per-instance model matrix (see instancing.h); the lamp is drawn through the render queue like everything else
+layout(location = 3) in mat4 aModel;  // takes locations 3-6
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common.glsl"
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+// materials (see material_system.h): one record per material in a storage buffer, indexed by
+// the per-instance material index. The maps are bindless texture handles when BINDLESS_TEXTURES
+// is defined, otherwise layers of one texture array (the handle's x holds the layer).
+
+struct MaterialRecord {
+    uvec2 diffuse;
+    uvec2 specular;
+    uvec2 emission;
+    float shininess;
+    uint flags;
+    vec4 specularColor;  // used where there is no specular map
+};
+
+const uint MATERIAL_SPECULAR_MAP = 1u;
+const uint MATERIAL_EMISSION_MAP = 2u;
+
+layout (std430, binding = 1) readonly buffer Materials
+{
+    MaterialRecord materials[];
+};
+
+#ifdef BINDLESS_TEXTURES
+vec4 sampleMaterial(uvec2 map, vec2 uv)
+{
+    return texture(sampler2D(map), uv);
+}
+#else
+uniform sampler2DArray materialTextures;
+
+vec4 sampleMaterial(uvec2 map, vec2 uv)
+{
+    return texture(materialTextures, vec3(uv, float(map.x)));
+}
+#endif
\ No newline at end of file
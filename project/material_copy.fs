@@ -0,0 +1,12 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D source;
+uniform float lod;  // mip level of the source closest to the layer size
+
+void main()
+{
+    FragColor = textureLod(source, uv, lod);
+}
\ No newline at end of file
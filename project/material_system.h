@@ -0,0 +1,295 @@
+#ifndef MATERIAL_SYSTEM_H
+#define MATERIAL_SYSTEM_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_ext.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_s.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\texture_loader.h>
+
+// Every material is one record in a shader storage buffer (material.glsl), picked per instance
+// by the material index of InstanceData, so one draw can cover objects with different maps.
+//
+// Maps are either ARB_bindless_texture handles of the loader's textures, or, where bindless
+// is missing (Mesa), layers of a single GL_TEXTURE_2D_ARRAY bound once per frame. A layer is
+// filled by drawing the loaded texture into it (so any format the loader produces, compressed
+// or swizzled, ends up as RGBA8), scaled to the layer size from the source mip level closest
+// to it. Until a texture is resident its layer or handle shows the loader's placeholder.
+
+const unsigned int MATERIAL_STORAGE_BINDING = 1;  // "Materials" buffer in material.glsl
+const unsigned int MATERIAL_TEXTURE_UNIT = 0;     // the texture array (array path only)
+
+enum MaterialFlags : uint32_t
+{
+    MATERIAL_SPECULAR_MAP = 1 << 0,
+    MATERIAL_EMISSION_MAP = 1 << 1
+};
+
+// std430 mirror of MaterialRecord in material.glsl
+struct MaterialRecord
+{
+    uint32_t diffuse[2];   // bindless handle (low, high), or (layer, 0)
+    uint32_t specular[2];
+    uint32_t emission[2];
+    float shininess;
+    uint32_t flags;
+    glm::vec4 specularColor;
+};
+static_assert(offsetof(MaterialRecord, shininess) == 24, "MaterialRecord must match the std430 layout");
+static_assert(offsetof(MaterialRecord, specularColor) == 32, "MaterialRecord must match the std430 layout");
+static_assert(sizeof(MaterialRecord) == 48, "MaterialRecord must match the std430 layout");
+
+// a material as the application describes it: TextureLoader handles, NO_MAP for a missing map
+struct MaterialDesc
+{
+    static const unsigned int NO_MAP = 0xFFFFFFFFu;
+
+    unsigned int diffuse = NO_MAP;
+    unsigned int specular = NO_MAP;
+    unsigned int emission = NO_MAP;
+    float shininess = 32.0f;
+    glm::vec3 specularColor = glm::vec3(0.5f);
+};
+
+class MaterialSystem
+{
+public:
+    // copyVertexPath/copyFragmentPath: material_copy.vs/.fs; layerSize: edge of the array layers
+    MaterialSystem(TextureLoader& loader, const char* copyVertexPath, const char* copyFragmentPath, bool allowBindless = true, int layerSize = 512)
+        : loader(loader), copyShader(copyVertexPath, copyFragmentPath), layerSize(layerSize)
+    {
+        useBindless = allowBindless && glExtensions().bindlessTexture;
+        glGenBuffers(1, &storage);
+        if (!useBindless)
+        {
+            glGenFramebuffers(1, &copyFramebuffer);
+            glGenVertexArrays(1, &copyVertexArray);
+            copyShader.use();
+            copyShader.setInt("source", 0);
+        }
+    }
+    MaterialSystem(const MaterialSystem&) = delete;
+    MaterialSystem& operator=(const MaterialSystem&) = delete;
+
+    // returns the material index for InstanceData / RenderQueue::submit
+    // ------------------------------------------------------------------------
+    uint32_t add(const MaterialDesc& desc)
+    {
+        descs.push_back(desc);
+        for (unsigned int map : { desc.diffuse, desc.specular, desc.emission })
+            if (map != MaterialDesc::NO_MAP)
+                mapSlot(map);
+        dirty = true;
+        return (uint32_t)descs.size() - 1;
+    }
+    size_t size() const
+    {
+        return descs.size();
+    }
+    bool bindless() const
+    {
+        return useBindless;
+    }
+
+    // GL thread, once per frame after TextureLoader::update(): pick up textures that became
+    // resident and re-upload the records when anything changed
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        if (!useBindless && (int)maps.size() > layerCapacity)
+            growArray();
+
+        bool copied = false;
+        for (size_t slot = 0; slot < maps.size(); slot++)
+        {
+            Map& map = maps[slot];
+            bool resident = loader.resident(map.loaderHandle);
+            if (map.filled && map.resident == resident)
+                continue;
+            if (useBindless)
+                map.handle = residentHandle(loader.texture(map.loaderHandle));
+            else
+            {
+                copyToLayer(loader.texture(map.loaderHandle), (int)slot);
+                copied = true;
+            }
+            map.filled = true;
+            map.resident = resident;
+            dirty = true;
+        }
+        if (copied)
+        {
+            glState().bindTexture(MATERIAL_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, array);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+        if (dirty)
+            uploadRecords();
+    }
+
+    // bind the storage buffer (and the texture array) for this frame's draws
+    void bind() const
+    {
+        glState().bindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_STORAGE_BINDING, storage);
+        if (!useBindless)
+            glState().bindTexture(MATERIAL_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, array);
+    }
+
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        if (glExtensions().MakeTextureHandleNonResidentARB)
+            for (GLuint64 handle : residentHandles)
+                glExtensions().MakeTextureHandleNonResidentARB(handle);
+        residentHandles.clear();
+        glDeleteBuffers(1, &storage);
+        glState().bufferDeleted(storage);
+        if (!useBindless)
+        {
+            glDeleteTextures(1, &array);
+            glState().textureDeleted(array);
+            glDeleteFramebuffers(1, &copyFramebuffer);
+            glDeleteVertexArrays(1, &copyVertexArray);
+            glState().vertexArrayDeleted(copyVertexArray);
+        }
+        glDeleteProgram(copyShader.ID);
+        glState().programDeleted(copyShader.ID);
+    }
+
+private:
+    // one per distinct loader texture: a layer in the array path, a handle in the bindless one
+    struct Map
+    {
+        unsigned int loaderHandle;
+        GLuint64 handle = 0;
+        bool filled = false;    // holds something, maybe the placeholder
+        bool resident = false;  // holds the real texture
+    };
+
+    TextureLoader& loader;
+    Shader copyShader;
+    int layerSize;
+    bool useBindless;
+    bool dirty = false;
+
+    std::vector<MaterialDesc> descs;
+    std::vector<Map> maps;
+    std::vector<MaterialRecord> records;
+    std::set<GLuint64> residentHandles;
+    unsigned int storage = 0;
+
+    unsigned int array = 0;
+    int layerCapacity = 0;
+    unsigned int copyFramebuffer = 0;
+    unsigned int copyVertexArray = 0;
+
+    unsigned int mapSlot(unsigned int loaderHandle)
+    {
+        for (size_t slot = 0; slot < maps.size(); slot++)
+            if (maps[slot].loaderHandle == loaderHandle)
+                return (unsigned int)slot;
+        Map map;
+        map.loaderHandle = loaderHandle;
+        maps.push_back(map);
+        return (unsigned int)maps.size() - 1;
+    }
+
+    GLuint64 residentHandle(unsigned int texture)
+    {
+        GLuint64 handle = glExtensions().GetTextureHandleARB(texture);
+        if (residentHandles.insert(handle).second)
+            glExtensions().MakeTextureHandleResidentARB(handle);
+        return handle;
+    }
+
+    void uploadRecords()
+    {
+        records.resize(descs.size());
+        for (size_t i = 0; i < descs.size(); i++)
+        {
+            const MaterialDesc& desc = descs[i];
+            MaterialRecord& record = records[i];
+            record = MaterialRecord();
+            writeMap(desc.diffuse, record.diffuse);
+            writeMap(desc.specular, record.specular);
+            writeMap(desc.emission, record.emission);
+            record.shininess = desc.shininess;
+            record.flags = 0;
+            if (desc.specular != MaterialDesc::NO_MAP)
+                record.flags |= MATERIAL_SPECULAR_MAP;
+            if (desc.emission != MaterialDesc::NO_MAP)
+                record.flags |= MATERIAL_EMISSION_MAP;
+            record.specularColor = glm::vec4(desc.specularColor, 1.0f);
+        }
+        glState().bindBuffer(GL_SHADER_STORAGE_BUFFER, storage);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, records.size() * sizeof(MaterialRecord), records.data(), GL_STATIC_DRAW);
+        dirty = false;
+    }
+    void writeMap(unsigned int loaderHandle, uint32_t out[2])
+    {
+        if (loaderHandle == MaterialDesc::NO_MAP)
+            return;
+        const Map& map = maps[mapSlot(loaderHandle)];
+        uint64_t value = useBindless ? map.handle : mapSlot(loaderHandle);
+        out[0] = (uint32_t)value;
+        out[1] = (uint32_t)(value >> 32);
+    }
+
+    // (re)allocate the array with room for every map; all layers are filled again
+    void growArray()
+    {
+        if (array != 0)
+        {
+            glDeleteTextures(1, &array);
+            glState().textureDeleted(array);
+        }
+        layerCapacity = std::max<int>((int)maps.size(), layerCapacity * 2);
+        int levels = 1 + (int)std::floor(std::log2((double)layerSize));
+        glGenTextures(1, &array);
+        glState().bindTexture(MATERIAL_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, array);
+        for (int level = 0, size = layerSize; level < levels; level++, size = std::max(1, size / 2))
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, layerCapacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        for (Map& map : maps)
+            map.filled = false;
+    }
+
+    // draw a texture into one layer, sampling the source at the mip level nearest the layer size
+    void copyToLayer(unsigned int texture, int layer)
+    {
+        GLint previousFramebuffer = 0, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, copyFramebuffer);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array, 0, layer);
+        glViewport(0, 0, layerSize, layerSize);
+        glState().disable(GL_DEPTH_TEST);
+
+        GLint width = 1, height = 1;
+        glState().bindTexture(0, GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        copyShader.use();
+        copyShader.setFloat("lod", std::max(0.0f, std::log2((float)std::max(width, height) / layerSize)));
+        glState().bindVertexArray(copyVertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glState().enable(GL_DEPTH_TEST, depthTest == GL_TRUE);
+    }
+};
+#endif
@@ -0,0 +1,287 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+// mesh-building stage every mesh goes through before it reaches the GPU:
+// 1. weldVertices:        merge bit-identical vertices and produce an index buffer
+// 2. optimizeVertexCache: reorder triangles for the post-transform vertex cache (Forsyth's algorithm)
+// 3. optimizeVertexFetch: reorder vertices into first-use order so fetches walk the buffer linearly
+// analyzeVertexCache reports ACMR (transformed vertices per triangle) and ATVR (transformed vertices
+// per unique vertex) by simulating a FIFO cache, so the effect of each step can be checked.
+
+template <typename Vertex>
+struct IndexedMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+struct VertexCacheStats
+{
+    float acmr;  // average cache miss ratio: transformed vertices / triangles (0.5 is ideal for large grids, 3 is the worst)
+    float atvr;  // average transformed vertex ratio: transformed vertices / vertices (1.0 is ideal)
+};
+
+// simulate a FIFO post-transform cache of the given size
+// ------------------------------------------------------------------------
+inline VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        // a vertex is still cached when fewer than cacheSize misses happened since it was loaded
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            misses++;
+        }
+    }
+    VertexCacheStats stats;
+    size_t triangles = indices.size() / 3;
+    stats.acmr = triangles > 0 ? (float)misses / triangles : 0.0f;
+    stats.atvr = vertexCount > 0 ? (float)misses / vertexCount : 0.0f;
+    return stats;
+}
+
+// merge vertices whose bytes are identical (the vertex type must not contain padding)
+// ------------------------------------------------------------------------
+template <typename Vertex>
+IndexedMesh<Vertex> weldVertices(const Vertex* vertices, size_t count)
+{
+    static_assert(std::is_trivially_copyable<Vertex>::value, "vertices are compared and hashed as raw bytes");
+
+    IndexedMesh<Vertex> mesh;
+    mesh.indices.resize(count);
+
+    // open addressing hash table over vertex bytes (FNV-1a), sized to stay at most half full
+    size_t tableSize = 1;
+    while (tableSize < count * 2)
+        tableSize <<= 1;
+    const unsigned int empty = ~0u;
+    std::vector<unsigned int> table(tableSize, empty);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertices[i]);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t b = 0; b < sizeof(Vertex); b++)
+            hash = (hash ^ bytes[b]) * 1099511628211ull;
+
+        size_t slot = (size_t)hash & (tableSize - 1);
+        while (table[slot] != empty && std::memcmp(&mesh.vertices[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == empty)
+        {
+            table[slot] = (unsigned int)mesh.vertices.size();
+            mesh.vertices.push_back(vertices[i]);
+        }
+        mesh.indices[i] = table[slot];
+    }
+    return mesh;
+}
+
+// Tom Forsyth's linear-speed vertex cache optimisation: repeatedly emit the triangle whose
+// vertices score highest, favouring vertices that are in the (simulated LRU) cache and vertices
+// with few remaining triangles, so isolated triangles do not get left behind. When nothing next to
+// the cache is left, the next triangle comes from a max-heap of the scores triangles have outside
+// the cache instead of a scan over all of them.
+// ------------------------------------------------------------------------
+inline void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    const int cacheSize = 32;
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    auto vertexScore = [](int cachePosition, unsigned int remainingTriangles) -> float
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f;  // the vertices of the last triangle get a fixed score so they are not reused too eagerly
+            else
+                score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (cacheSize - 3)), 1.5f);
+        }
+        return score + 2.0f * std::pow((float)remainingTriangles, -0.5f);
+    };
+
+    // vertex -> triangle adjacency
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    std::vector<bool> emitted(triangleCount, false);
+
+    // fallback candidates: a triangle is pushed again whenever one of its vertices leaves the cache,
+    // which is the only time its score outside the cache changes; entries whose score no longer
+    // matches are stale and skipped. ties go to the lower triangle index.
+    typedef std::pair<float, unsigned int> Candidate;
+    auto lowerPriority = [](const Candidate& a, const Candidate& b) { return a.first < b.first || (a.first == b.first && a.second > b.second); };
+    std::vector<Candidate> candidates;
+    candidates.reserve(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        candidates.push_back(Candidate(triangleScore[t], (unsigned int)t));
+    std::make_heap(candidates.begin(), candidates.end(), lowerPriority);
+
+    std::vector<unsigned int> cache, nextCache;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    long bestTriangle = -1;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        while (bestTriangle < 0)
+        {
+            // nothing adjacent to the cache is left: take the best remaining triangle
+            Candidate top = candidates.front();
+            std::pop_heap(candidates.begin(), candidates.end(), lowerPriority);
+            candidates.pop_back();
+            if (!emitted[top.second] && triangleScore[top.second] == top.first)
+                bestTriangle = (long)top.second;
+        }
+
+        const unsigned int* triangle = &indices[bestTriangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // move the triangle's vertices to the front of the cache and drop the triangle from their lists
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            unsigned int* begin = &adjacency[offsets[v]];
+            unsigned int* end = begin + remaining[v];
+            std::remove(begin, end, (unsigned int)bestTriangle);
+            remaining[v]--;
+        }
+
+        // rescore everything that was or is in the cache, then pick the best triangle touching it
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < (size_t)cacheSize ? (int)i : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        // the triangles of evicted vertices lost their cache bonus
+        for (size_t i = cacheSize; i < nextCache.size(); i++)
+        {
+            unsigned int v = nextCache[i];
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                unsigned int t = adjacency[a];
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                candidates.push_back(Candidate(triangleScore[t], t));
+                std::push_heap(candidates.begin(), candidates.end(), lowerPriority);
+            }
+        }
+        if (nextCache.size() > (size_t)cacheSize)
+            nextCache.resize(cacheSize);
+        cache.swap(nextCache);
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache)
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                unsigned int t = adjacency[a];
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = (long)t;
+                }
+            }
+    }
+    indices.swap(result);
+}
+
+// reorder vertices into the order the index buffer first references them
+// ------------------------------------------------------------------------
+template <typename Vertex>
+void optimizeVertexFetch(IndexedMesh<Vertex>& mesh)
+{
+    const unsigned int unassigned = ~0u;
+    std::vector<unsigned int> remap(mesh.vertices.size(), unassigned);
+    std::vector<Vertex> ordered;
+    ordered.reserve(mesh.vertices.size());
+    for (unsigned int& index : mesh.indices)
+    {
+        if (remap[index] == unassigned)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(ordered);  // vertices no triangle references are dropped
+}
+
+// run the whole stage on an unindexed triangle list and report what it did
+// ------------------------------------------------------------------------
+template <typename Vertex>
+IndexedMesh<Vertex> buildIndexedMesh(const Vertex* vertices, size_t count, const char* name)
+{
+    std::vector<unsigned int> unindexed(count);
+    for (size_t i = 0; i < count; i++)
+        unindexed[i] = (unsigned int)i;
+    VertexCacheStats before = analyzeVertexCache(unindexed, count);
+
+    IndexedMesh<Vertex> mesh = weldVertices(vertices, count);
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeVertexFetch(mesh);
+    VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    std::cout << "mesh " << name << ": " << count << " -> " << mesh.vertices.size() << " vertices, "
+              << mesh.indices.size() / 3 << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    return mesh;
+}
+
+// fill the bound GL_ELEMENT_ARRAY_BUFFER, using 16 bit indices whenever they fit.
+// returns the index type to pass to glDrawElements
+// ------------------------------------------------------------------------
+inline GLenum uploadIndices(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    if (vertexCount <= 0xFFFF)
+    {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+        return GL_UNSIGNED_SHORT;
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    return GL_UNSIGNED_INT;
+}
+#endif
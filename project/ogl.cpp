@@ -1,17 +1,51 @@
 #include <glad/glad.h>
 #include <C:\glfw-3.3.8\include\GLFW\glfw3.h>
 #include <iostream>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_ext.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
 #include <C:\hLib\glProject\LearnOpenGL\project\shader_s.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_watcher.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_permutations.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <C:\hLib\glProject\LearnOpenGL\project\camera.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\frame_uniforms.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\transform.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\stress_scene.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\frustum_culling.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\bvh.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\job_system.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\mesh_builder.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\vertex_format.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\texture_loader.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\gpu_profiler.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\cpu_profiler.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\headless.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\input_recording.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\render_queue.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\material_system.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\fixed_timestep.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\frame_pacing.h>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-unsigned int loadTexture(char const* path);
+uint8_t readInputKeys(GLFWwindow* window);
+void processInput(GLFWwindow* window, uint8_t keys);
+void simulateStep(float step);
+void mouseMoved(float xpos, float ypos);
+void applyInputEvents(const std::vector<InputEvent>& events);
+void parseArguments(int argc, char* argv[]);
+int benchmarkCulling();
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -22,60 +56,200 @@ Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+// the camera before the last simulation step; frames show it interpolated towards camera
+CameraPose previousPose = CameraPose::of(camera);
 
-// timing
+// picking: a left click casts a ray from the camera through the centre of the screen
+uint8_t previousKeys = 0;
+bool pickRequested = false;
+
+// keys read this frame, applied by every simulation step
+uint8_t heldKeys = 0;
+
+// timing: real time between frames; the simulation advances in fixed steps of 1/simulationRate
+// (--sim-hz N, default 120) no matter how long the frames take
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+float simulationRate = 120.0f;
 
 // lighting
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
-int main()
+// stress scene (command line: --cubes N [--animate])
+unsigned int stressCubes = 0;
+bool stressAnimate = false;
+
+// stress cubes outside the view frustum are skipped (--no-cull draws all of them);
+// --bench-cull times the culling kernels on 100k and 1M spheres and exits
+bool frustumCulling = true;
+bool cullBenchmark = false;
+
+// --bvh-cull culls the stress cubes by walking the scene BVH instead of testing every sphere
+bool bvhCulling = false;
+
+// threads of the job system (culling, animation, draw recording, texture decodes, shader reads), the
+// main thread included (--threads N, 1 = everything on the main thread; default one per core, at most 8)
+unsigned int frameThreads = 0;
+
+// GPU pass timings are printed at exit; --gpu-profile <file.csv> also writes them out
+const char* gpuProfilePath = NULL;
+
+// CPU zones: --trace <file.json> writes a Chrome trace at exit, frames over --hitch-ms (default 50,
+// 0 = off) dump the last frames to hitch_<frame>.json, --no-profile turns recording off
+const char* tracePath = NULL;
+double hitchBudgetMs = 50.0;
+bool cpuProfiling = true;
+
+// headless benchmark: --headless N renders N frames at --size WxH (default 1280x720) into an
+// offscreen framebuffer at a fixed 60 Hz simulated time step; --hash prints a hash of the last frame
+unsigned int headlessFrames = 0;
+int headlessWidth = 1280;
+int headlessHeight = 720;
+bool headlessHash = false;
+const float HEADLESS_FRAME_TIME = 1.0f / 60.0f;
+
+// input capture: --record <file> writes every frame's time, keys and mouse/scroll events;
+// --replay <file> plays them back instead of live input (with --fixed-step [hz] the recorded
+// frame times are replaced by a fixed step, 60 Hz by default), then exits
+const char* recordPath = NULL;
+const char* replayPath = NULL;
+float replayFixedStep = 0.0f;
+InputRecorder inputRecorder;
+InputReplay inputReplay;
+
+// latency mode (--latency): the frames in flight are bounded by fences (--frames-in-flight N, 1-3; 1 with
+// --latency), input is read again after waiting on them and on the frame limiter (--fps-limit N, 0 = off),
+// and mouse look is re-latched into FrameData right before the draws are submitted. Culling then uses
+// a frustum LATE_LATCH_CULL_MARGIN degrees wider, for the turn still to come. --swap-interval N sets
+// the vsync interval (default: the driver's)
+bool latencyMode = false;
+unsigned int framesInFlight = 0;
+double fpsLimit = 0.0;
+int swapInterval = -1;
+const float LATE_LATCH_CULL_MARGIN = 10.0f;
+
+// material maps are bindless texture handles where the driver supports them; --no-bindless forces
+// the texture array path
+bool allowBindless = true;
+
+int main(int argc, char* argv[])
 {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
+    parseArguments(argc, argv);
+    if (cullBenchmark)
+        return benchmarkCulling();
+    if (latencyMode && framesInFlight == 0)
+        framesInFlight = 1;
+
+    // headless (--headless N): no window, N frames rendered offscreen along a scripted camera path
+    GLFWwindow* window = NULL;
+    HeadlessContext headlessContext;
+    GLADloadproc loader = (GLADloadproc)glfwGetProcAddress;
+    if (headlessFrames > 0)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        if (!headlessContext.create())
+        {
+            std::cout << "Failed to create a headless OpenGL context" << std::endl;
+            return -1;
+        }
+        loader = headlessContext.loader();
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    else
+    {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    #ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    #endif
+
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        if (swapInterval >= 0)
+            glfwSwapInterval(swapInterval);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (!gladLoadGLLoader(loader))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    loadGLExtensions(loader);
+
+    // input capture / replay
+    if (recordPath && !inputRecorder.open(recordPath))
+        std::cout << "failed to open " << recordPath << " for recording" << std::endl;
+    if (replayPath)
+    {
+        if (!inputReplay.open(replayPath))
+        {
+            std::cout << "failed to read the input recording " << replayPath << std::endl;
+            return -1;
+        }
+        // a headless replay runs to the end of the recording
+        if (!window)
+            headlessFrames = (unsigned int)inputReplay.frameCount();
+        std::cout << "input: replaying " << inputReplay.frameCount() << " frames from " << replayPath << std::endl;
+    }
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    // binds, program switches and switches like these go through glState(), which drops the redundant ones
+    glState().enable(GL_DEPTH_TEST);
 
-    // build and compile our shader zprogram
+    // build and compile our shader zprogram (linked from shader_cache/ when a matching binary exists)
     // ------------------------------------
-    Shader lightingShader("C:/hLib/glProject/LearnOpenGL/project/shader.vs", "C:/hLib/glProject/LearnOpenGL/project/shader.fs");
+    // everything is drawn instanced through the render queue (see render_queue.h); the lit shaders
+    // are built per material feature set (see shader_permutations.h) and every
+    // program is recompiled when one of its source files changes while running
+    auto shaderStart = std::chrono::steady_clock::now();
+
+    // one work-stealing job system runs all CPU work off the GL calls (see job_system.h): shader and
+    // texture files in the background, culling, animation and packet recording every frame
+    JobSystem jobs(frameThreads);
+
+    ShaderWatcher shaderWatcher;
+    auto materialSamplers = [](Shader& shader)
+    {
+        shader.setInt("materialTextures", MATERIAL_TEXTURE_UNIT);
+    };
+    ShaderPermutations instancedShaders("C:/hLib/glProject/LearnOpenGL/project/shader_instanced.vs", "C:/hLib/glProject/LearnOpenGL/project/shader.fs", materialSamplers, &shaderWatcher);
     Shader lightCubeShader("C:/hLib/glProject/LearnOpenGL/project/light_cube.vs", "C:/hLib/glProject/LearnOpenGL/project/light_cube.fs");
+    shaderWatcher.add(lightCubeShader);
+
+    // the centre cube uses every map; the stress cubes skip the emission map and its scrolling/mask math.
+    // Materials come from a storage buffer (see material_system.h), so within a program each instance can
+    // use a different one; the maps are sampled through bindless handles when the driver has them
+    const bool bindlessMaterials = allowBindless && glExtensions().bindlessTexture;
+    const unsigned int textureFeature = bindlessMaterials ? FEATURE_BINDLESS_TEXTURES : 0;
+    const unsigned int cubeFeatures = FEATURE_SPECULAR_MAP | FEATURE_EMISSION_MAP | textureFeature;
+    const unsigned int stressFeatures = FEATURE_SPECULAR_MAP | textureFeature;
+    std::vector<unsigned int> usedFeatures = { cubeFeatures };
+    if (stressCubes > 0)
+        usedFeatures.push_back(stressFeatures);
+    instancedShaders.warm(usedFeatures, &jobs);
+    const ProgramCacheStats& cacheStats = programCacheStats();
+    std::cout << "shaders ready in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count() << " ms: " << cacheStats.hits << " from the program cache, "
+              << cacheStats.misses + cacheStats.rejected << " compiled" << (glExtensions().programBinary ? "" : " (program binaries unsupported)") << std::endl;
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -124,162 +298,721 @@ int main()
         -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
         -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
     };
-    // first, configure the cube's VAO (and VBO)
-    unsigned int VBO, cubeVAO;
+    // weld the expanded triangle list into an indexed mesh ordered for the post-transform cache
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must match the layout of vertices[]");
+    std::vector<Vertex> cubeTriangles(sizeof(vertices) / (8 * sizeof(float)));
+    std::memcpy(cubeTriangles.data(), vertices, sizeof(vertices));
+    IndexedMesh<Vertex> cubeMesh = buildIndexedMesh(cubeTriangles.data(), cubeTriangles.size(), "cube");
+
+    // pack for the GPU: 32 -> 16 bytes per vertex
+    std::vector<PackedVertex> cubeVertices;
+    for (const Vertex& vertex : cubeMesh.vertices)
+        cubeVertices.push_back(packVertex(vertex));
+
+    // first, configure the cube's VAO (and VBO + EBO)
+    unsigned int VBO, EBO, cubeVAO;
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, cubeVertices.size() * sizeof(PackedVertex), cubeVertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glState().bindVertexArray(cubeVAO);
 
-    glBindVertexArray(cubeVAO);
+    // the element buffer binding is part of the VAO state
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLenum cubeIndexType = uploadIndices(cubeMesh.indices, cubeMesh.vertices.size());
+    GLsizei cubeIndexCount = (GLsizei)cubeMesh.indices.size();
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // normal attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // position, normal and texture coordinate attributes, generated from the PackedVertex format
+    applyVertexFormat<PackedVertex>();
 
     // second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
     unsigned int lightCubeVAO;
     glGenVertexArrays(1, &lightCubeVAO);
-    glBindVertexArray(lightCubeVAO);
-
-    // we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, but we do it again for educational purposes)
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Set vertex attribute pointers
-    // 0 is attribute location, 3 is how many numbers (floats in this case), GL_FLOAT is type, 8 * sizeof... is STRIDE in buffer
-    // where the STRIDE includes the whole vertex attribute such as XYZRGBST in this case where each value is 4 bytes,
-    // (void*)0 is starting point, 3* sizeof(float) is 3 * 4 which is 12 as the offset from the beginning of vertex attribute array
-    // 6 * sizeof (float) is 6 * 4 which is 24 as the offset from beginning of vertex attribute array
-    
-    unsigned int diffuseMap = loadTexture("C:/hLib/glProject/LearnOpenGL/borg.jpg");
-    unsigned int specularMap = loadTexture("C:/hLib/glProject/LearnOpenGL/container2_specular.png");
-    unsigned int emissionMap = loadTexture("C:/hLib/glProject/LearnOpenGL/lights.png");
-
-    // shader configuration
-    // --------------------
-    lightingShader.use();
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);
-    lightingShader.setInt("material.emission", 2);
+    glState().bindVertexArray(lightCubeVAO);
+
+    // we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, so the state cache drops this bind)
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    // the light cube shader only reads the position, the other attributes are simply ignored
+    applyVertexFormat<PackedVertex>();
+
+    // Vertex attribute pointers come from VertexFormat<> tables (see vertex_format.h): the stride is the
+    // size of the vertex struct and every offset is taken with offsetof, so they cannot drift out of sync
+
+    // objects submit draw packets to the render queue, which sorts them and merges equal state into
+    // instanced draws; its per-instance model/normal matrices live in a second buffer attached to both VAOs.
+    // Every job thread records into its own draw list of the queue
+    RenderQueue renderQueue(jobs.threadCount());
+    RenderMesh cubeRenderMesh = { cubeVAO, cubeIndexCount, cubeIndexType };
+    RenderMesh lampRenderMesh = { lightCubeVAO, cubeIndexCount, cubeIndexType };
+    renderQueue.attach(cubeRenderMesh);
+    renderQueue.attach(lampRenderMesh);
+
+    StressScene stressScene;
+    if (stressCubes > 0)
+    {
+        stressScene.build(stressCubes, stressAnimate);
+        std::cout << "stress scene: " << stressCubes << " cubes" << (stressAnimate ? " (animated)" : "") << std::endl;
+    }
+
+    // the stress cubes are culled against the view frustum every frame (see frustum_culling.h);
+    // only the visible ones are animated and submitted
+    FrustumCuller frustumCuller(jobs);
+    std::vector<uint32_t> allCubes(stressScene.size());
+    std::iota(allCubes.begin(), allCubes.end(), 0u);
+    std::vector<uint32_t> bvhVisible, bvhCubes;
+    size_t visibleCubesTotal = 0;
+
+    // every object in one BVH (see bvh.h), by bounding sphere, for picking and --bvh-cull:
+    // stress cube i is object i, followed by the lit cube and the lamp
+    const uint32_t litCubeObject = stressScene.size();
+    const uint32_t lampObject = litCubeObject + 1;
+    auto objectSphere = [&](uint32_t object)
+    {
+        if (object == litCubeObject)
+            return glm::vec4(0.0f, 0.0f, 0.0f, 0.8660254f);
+        if (object == lampObject)
+            return glm::vec4(lightPos, 0.2f * 0.8660254f);
+        return glm::vec4(stressScene.bounds.x[object], stressScene.bounds.y[object], stressScene.bounds.z[object], stressScene.bounds.radius[object]);
+    };
+    DynamicBvh sceneBvh;
+    for (uint32_t object = 0; object <= lampObject; object++)
+    {
+        glm::vec4 sphere = objectSphere(object);
+        sceneBvh.insert(sphereAabb(glm::vec3(sphere), sphere.w), object);
+    }
+    sceneBvh.rebuild();
+    sceneBvh.print(std::cout);
+    uint32_t pickedObject = UINT32_MAX;
+
+    // textures are decoded by background jobs and streamed in over the next frames;
+    // until then textureLoader.texture() hands out a placeholder
+    TextureLoader textureLoader(jobs);
+    unsigned int diffuseMap = textureLoader.load("C:/hLib/glProject/LearnOpenGL/borg.jpg");
+    unsigned int specularMap = textureLoader.load("C:/hLib/glProject/LearnOpenGL/container2_specular.png", false);
+    unsigned int emissionMap = textureLoader.load("C:/hLib/glProject/LearnOpenGL/lights.png");
+
+    // materials: the centre cube uses all three maps; the stress cubes cycle through a few materials with
+    // different maps (or a constant specular colour), all drawn by one call. The lamp reads no material.
+    MaterialSystem materials(textureLoader, "C:/hLib/glProject/LearnOpenGL/project/material_copy.vs", "C:/hLib/glProject/LearnOpenGL/project/material_copy.fs", bindlessMaterials);
+    MaterialDesc material;
+    material.diffuse = diffuseMap;
+    material.specular = specularMap;
+    material.emission = emissionMap;
+    uint32_t cubeMaterial = materials.add(material);
+    std::vector<uint32_t> stressMaterials;
+    material.emission = MaterialDesc::NO_MAP;
+    stressMaterials.push_back(materials.add(material));
+    material.diffuse = emissionMap;
+    stressMaterials.push_back(materials.add(material));
+    material.diffuse = diffuseMap;
+    material.specular = MaterialDesc::NO_MAP;
+    material.specularColor = glm::vec3(0.8f);
+    material.shininess = 64.0f;
+    stressMaterials.push_back(materials.add(material));
+    material.diffuse = emissionMap;
+    material.specularColor = glm::vec3(0.2f);
+    material.shininess = 8.0f;
+    stressMaterials.push_back(materials.add(material));
+    const uint32_t lampMaterial = 0;
+    std::cout << "materials: " << materials.size() << " in a storage buffer, maps as "
+              << (materials.bindless() ? "bindless handles" : "texture array layers") << std::endl;
+
+    // uniform buffer for the per-frame FrameData block shared by all programs
+    FrameUniforms frameUniforms;
+
+    // the far plane has to reach the back of the stress scene
+    float farPlane = stressCubes > 0 ? 500.0f : 100.0f;
+
+    // GPU time per render pass, read back a few frames late so it never stalls
+    GpuProfiler gpuProfiler;
+
+    // CPU zones of this and every worker thread, with a flight recorder for slow frames
+    cpuProfiler().setEnabled(cpuProfiling);
+    cpuProfiler().setThreadName("main");
+    cpuProfiler().setFrameBudget(hitchBudgetMs);
+
+    // frame time shown in the window title, averaged over one second
+    float titleTimer = 0.0f;
+    unsigned int titleFrames = 0;
+
+    // headless: render into an offscreen framebuffer
+    RenderTarget renderTarget;
+    std::vector<double> headlessFrameTimes;
+    float aspectRatio = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    if (!window)
+    {
+        if (!renderTarget.create(headlessWidth, headlessHeight))
+            std::cout << "headless render target " << headlessWidth << "x" << headlessHeight << " is incomplete" << std::endl;
+        aspectRatio = (float)headlessWidth / (float)headlessHeight;
+        headlessFrameTimes.reserve(headlessFrames);
+    }
+    // headless runs and replays wait for every texture first, so each run draws exactly the same frames
+    if (!window || inputReplay.replaying())
+    {
+        while (!textureLoader.idle())
+        {
+            jobs.runMainThreadJobs();
+            textureLoader.update();
+        }
+    }
+    auto headlessStart = std::chrono::steady_clock::now();
+
+    // camera movement and the time the scene animates with are simulated at a fixed rate, see
+    // fixed_timestep.h; headless runs put the camera at the start of its path before the first step
+    FixedTimestep simulation(simulationRate);
+    if (!window && !inputReplay.replaying())
+    {
+        followCameraPath(camera, 0.0f);
+        previousPose = CameraPose::of(camera);
+    }
+
+    // frames in flight, frame limiter and input-to-submit latency (see frame_pacing.h). The late latch
+    // stays off while recording or replaying, which apply mouse input between frames only
+    FramePacer framePacer(framesInFlight, fpsLimit);
+    const bool lateLatch = latencyMode && window && !recordPath && !inputReplay.replaying();
+    framePacer.markInput();
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    unsigned int frameNumber = 0;
+    while ((window ? !glfwWindowShouldClose(window) : frameNumber < headlessFrames) && !inputReplay.finished())
     {
-        // per-frame time logic
+        cpuProfiler().frameMark();
+        PROFILE_ZONE("frame");
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // wait for the GPU and the frame limiter first, so the input below is as fresh as it can be
+        framePacer.beginFrame();
+        if (lateLatch)
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        if (lateLatch || !window || inputReplay.replaying())
+            framePacer.markInput();
+
+        // per-frame time logic: a replay takes the recorded (or fixed-step) time,
+        // headless runs advance a fixed step per frame
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
+        const InputFrame* replayFrame = inputReplay.replaying() ? &inputReplay.advance(replayFixedStep) : NULL;
+        float currentFrame = replayFrame ? replayFrame->time : window ? static_cast<float>(glfwGetTime()) : frameNumber * HEADLESS_FRAME_TIME;
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        // input
-        // -----
-        processInput(window);
+        titleTimer += deltaTime;
+        titleFrames++;
+        if (window && titleTimer >= 1.0f)
+        {
+            std::string title = "LearnOpenGL - " + std::to_string(stressCubes + 2) + " cubes - " + std::to_string(1000.0f * titleTimer / titleFrames) + " ms/frame - "
+                              + std::to_string(renderQueue.lastFrame().draws) + " draws - " + std::to_string(glState().lastFrame().totalElided()) + " GL calls elided";
+            glfwSetWindowTitle(window, title.c_str());
+            titleTimer = 0.0f;
+            titleFrames = 0;
+        }
 
-        // render
-        // ------
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // input: read once per frame, the held keys then move the camera in every simulation step
+        // -----
+        {
+            PROFILE_ZONE("processInput");
+            if (replayFrame)
+                processInput(window, replayFrame->keys);
+            else if (window)
+            {
+                uint8_t keys = readInputKeys(window);
+                inputRecorder.setKeys(keys);
+                processInput(window, keys);
+            }
+        }
 
-        // be sure to activate shader when setting uniforms/drawing objects
-        lightingShader.use();
-        lightingShader.setVec3("light.position", lightPos);   // globally defined at top of file (lightPos)
-        lightingShader.setVec3("viewPos", camera.Position);
+        // simulation: as many fixed steps as fit into the time up to this frame; headless runs
+        // simulate the scripted camera path instead of keys
+        // ----------
+        {
+            PROFILE_ZONE("simulation");
+            simulation.beginFrame(currentFrame);
+            while (simulation.step())
+            {
+                previousPose = CameraPose::of(camera);
+                if (window || replayFrame)
+                    simulateStep((float)simulation.stepLength());
+                else
+                    followCameraPath(camera, (float)simulation.time());
+            }
+        }
+        // the camera this frame shows: between the last two simulated poses
+        Camera viewCamera = camera;
+        interpolatePose(previousPose, CameraPose::of(camera), simulation.alpha()).applyTo(viewCamera);
 
-        // lighting properties
-        lightingShader.setVec3("light.ambient", 1.0f, 1.0f, 1.0f);
-        lightingShader.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
-        lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+        // picking: the closest object whose bounding sphere the view ray hits
+        if (pickRequested)
+        {
+            PROFILE_ZONE("pick");
+            pickRequested = false;
+            auto sphereHit = [&](uint32_t object)
+            {
+                glm::vec4 sphere = objectSphere(object);
+                return raySphere(viewCamera.Position, viewCamera.Front, glm::vec3(sphere), sphere.w);
+            };
+            BvhRayHit hit;
+            if (sceneBvh.raycast(viewCamera.Position, viewCamera.Front, farPlane, sphereHit, hit))
+            {
+                pickedObject = hit.object;
+                std::cout << "picked " << (hit.object == litCubeObject ? "the lit cube" : hit.object == lampObject ? "the lamp" : "stress cube " + std::to_string(hit.object))
+                          << " at " << hit.distance << std::endl;
+            }
+            else
+                pickedObject = UINT32_MAX;
+        }
 
-        // material properties
-        lightingShader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
-        lightingShader.setFloat("material.shininess", 32.0f);
+        // GL work queued by jobs (decoded textures), then continue streaming textures that finished
+        // decoding and hand finished ones to the materials
+        {
+            PROFILE_ZONE("texture upload");
+            jobs.runMainThreadJobs();
+            textureLoader.update();
+            materials.update();
+        }
 
-        // time 
-        lightingShader.setFloat("time", glfwGetTime());
+        // swap in shaders edited on disk once their new program has linked
+        {
+            PROFILE_ZONE("shader reload");
+            shaderWatcher.update();
+        }
 
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
+        // render
+        // ------
+        gpuProfiler.beginFrame();
+        {
+            GpuZone zone(gpuProfiler, "clear");
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
 
-        // world transformation
-        glm::mat4 model = glm::mat4(1.0f);
-        lightingShader.setMat4("model", model);
+        // per-frame data: written once into the FrameData uniform buffer and read by every program
+        FrameData frame;
+        {
+            PROFILE_ZONE("frame uniforms");
+            frame.view = viewCamera.GetViewMatrix();
+            frame.projection = glm::perspective(glm::radians(viewCamera.Zoom), aspectRatio, 0.1f, farPlane);
+            frame.viewPos = viewCamera.Position;
+            frame.time = (float)simulation.renderTime();
+            frame.light.position = lightPos;   // globally defined at top of file (lightPos)
+            frame.light.ambient = glm::vec3(1.0f, 1.0f, 1.0f);
+            frame.light.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+            frame.light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+            frameUniforms.update(frame);
+        }
 
-        // bind diffuse map
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        // submit every object as a draw packet; the queue decides the order and the batching
+        CpuZone drawZone("draw submission");
+        renderQueue.begin(frame.view, farPlane);
 
-        // bind specular map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
+        // the lit cube at the origin
+        renderQueue.submit(RENDER_PASS_OPAQUE, instancedShaders.get(cubeFeatures), cubeMaterial, cubeRenderMesh, makeInstance(glm::mat4(1.0f)));
 
-        // bind emission map
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, emissionMap);
+        // the stress scene, one packet per visible cube; they all end up in a single instanced draw
+        if (stressScene.size() > 0)
+        {
+            const std::vector<uint32_t>* visibleCubes = &allCubes;
+            glm::mat4 cullProjection = frame.projection;
+            if (lateLatch)
+                cullProjection = glm::perspective(glm::radians(std::min(viewCamera.Zoom + LATE_LATCH_CULL_MARGIN, 170.0f)), aspectRatio, 0.1f, farPlane);
+            Frustum cullFrustum = extractFrustum(cullProjection * frame.view);
+            if (frustumCulling && bvhCulling)
+            {
+                PROFILE_ZONE("frustum culling");
+                sceneBvh.queryFrustum(cullFrustum, bvhVisible);
+                bvhCubes.clear();
+                for (uint32_t object : bvhVisible)
+                    if (object < litCubeObject)
+                        bvhCubes.push_back(object);
+                visibleCubes = &bvhCubes;
+            }
+            else if (frustumCulling)
+            {
+                PROFILE_ZONE("frustum culling");
+                visibleCubes = &frustumCuller.cull(cullFrustum, stressScene.bounds);
+            }
+            visibleCubesTotal += visibleCubes->size();
 
-        // render the cube
-        glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+            // the job threads animate and record chunks of the visible cubes, each into its own
+            // draw list; nothing here touches GL
+            // the picked cube is drawn by the lit cube's program with its material: the stress program
+            // has the emission map compiled out, so that material alone would not show
+            Shader& stressShader = instancedShaders.get(stressFeatures);
+            Shader& highlightShader = instancedShaders.get(cubeFeatures);
+            PROFILE_ZONE("record stress cubes");
+            const std::vector<uint32_t>& visible = *visibleCubes;
+            jobs.parallelFor(visible.size(), 1024, [&](size_t begin, size_t end, unsigned int thread)
+            {
+                PROFILE_ZONE("record chunk");
+                if (stressScene.animated)
+                    stressScene.update(frame.time, visible.data() + begin, end - begin);
+                DrawList& drawList = renderQueue.drawList(thread);
+                for (size_t k = begin; k < end; k++)
+                {
+                    uint32_t i = visible[k];
+                    if (i == pickedObject)
+                        drawList.submit(RENDER_PASS_OPAQUE, highlightShader, cubeMaterial, cubeRenderMesh, stressScene.instances[i]);
+                    else
+                        drawList.submit(RENDER_PASS_OPAQUE, stressShader, stressMaterials[i % stressMaterials.size()], cubeRenderMesh, stressScene.instances[i]);
+                }
+            });
+        }
 
         // also draw the lamp object
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
+        glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, lightPos);
         model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
-        lightCubeShader.setMat4("model", model);
-
-        glBindVertexArray(lightCubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        renderQueue.submit(RENDER_PASS_OPAQUE, lightCubeShader, lampMaterial, lampRenderMesh, makeInstance(model));
 
+        // late latch: mouse look since the frame started turns the camera now, right before the draws
+        // that read FrameData are submitted; the simulated position stays
+        if (lateLatch)
+        {
+            PROFILE_ZONE("late latch");
+            glfwPollEvents();
+            framePacer.markInput();
+            interpolatePose(previousPose, CameraPose::of(camera), simulation.alpha()).applyTo(viewCamera);
+            viewCamera.Zoom = camera.Zoom;
+            frame.view = viewCamera.GetViewMatrix();
+            frame.projection = glm::perspective(glm::radians(viewCamera.Zoom), aspectRatio, 0.1f, farPlane);
+            frameUniforms.update(frame);
+        }
+        {
+            GpuZone zone(gpuProfiler, "scene");
+            materials.bind();
+            renderQueue.execute();
+            framePacer.markSubmit();
+        }
+        gpuProfiler.endFrame();
+        glState().endFrame();
+        drawZone.close();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window)
+        {
+            {
+                PROFILE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(window);
+            }
+            {
+                PROFILE_ZONE("glfwPollEvents");
+                glfwPollEvents();
+                framePacer.markInput();
+            }
+        }
+        else
+        {
+            // nothing presents a headless frame, so wait for the GPU to make the frame time honest
+            PROFILE_ZONE("glFinish");
+            glFinish();
+            headlessFrameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        }
+
+        framePacer.endFrame();
+
+        // mouse and scroll events land between frames, where glfwPollEvents delivered them
+        if (replayFrame)
+            applyInputEvents(replayFrame->events);
+        inputRecorder.endFrame(currentFrame);
+        frameNumber++;
+    }
+    inputRecorder.close();
+
+    // headless: frame time percentiles, throughput and optionally a hash of the last image
+    if (!window)
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - headlessStart).count();
+        FrameTimeReport report = FrameTimeReport::from(headlessFrameTimes);
+        unsigned int cubes = stressCubes + 2;
+        std::cout << "headless (" << headlessContext.backend() << ", " << glGetString(GL_RENDERER) << "): "
+                  << headlessFrames << " frames at " << headlessWidth << "x" << headlessHeight << ", " << cubes << " cubes" << std::endl;
+        std::cout << "frame ms: min " << report.min << "  p50 " << report.p50 << "  p90 " << report.p90
+                  << "  p99 " << report.p99 << "  max " << report.max << "  mean " << report.mean << std::endl;
+        if (seconds > 0.0)
+            std::cout << "throughput: " << headlessFrames / seconds << " frames/s, "
+                      << (double)headlessFrames * cubes / seconds << " cubes/s" << std::endl;
+        if (headlessHash)
+            std::cout << "image hash: " << std::hex << renderTarget.hash() << std::dec << std::endl;
     }
 
+    // report how many uniform uploads the shader-side value cache saved
+    const Shader::UniformStats& litStats = instancedShaders.get(cubeFeatures).uniformStats();
+    const Shader::UniformStats& lampStats = lightCubeShader.uniformStats();
+    std::cout << "uniform uploads: " << litStats.sent + lampStats.sent << " sent, "
+              << litStats.skipped + lampStats.skipped << " skipped (unchanged)" << std::endl;
+
+    // stress cubes that survived culling
+    if (stressScene.size() > 0 && frameNumber > 0)
+        std::cout << "frustum culling (" << (!frustumCulling ? "off" : bvhCulling ? "bvh" : cullLevelName(cullLevel())) << ", " << frustumCuller.threadCount() << " threads): "
+                  << (double)visibleCubesTotal / frameNumber << " of " << stressScene.size() << " stress cubes visible per frame" << std::endl;
+
+    // simulation steps per frame, and time the spiral-of-death guard dropped
+    simulation.print(std::cout);
+
+    // time spent waiting on the GPU and in the frame limiter, and input-to-submit latency
+    framePacer.print(std::cout);
+
+    // packets merged into instanced draws, and the state changes the cache issued and dropped
+    renderQueue.print(std::cout);
+    glState().print(std::cout);
+
+    // GPU time per pass over the last frames
+    gpuProfiler.print(std::cout);
+    if (gpuProfilePath && !gpuProfiler.writeCsv(gpuProfilePath))
+        std::cout << "failed to write " << gpuProfilePath << std::endl;
+    if (tracePath && !cpuProfiler().writeChromeTrace(tracePath))
+        std::cout << "failed to write " << tracePath << std::endl;
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &lightCubeVAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &frameUniforms.ID);
+    renderQueue.release();
+    instancedShaders.release();
+    glDeleteProgram(lightCubeShader.ID);
+    glState().programDeleted(lightCubeShader.ID);
+    materials.release();
+    textureLoader.release();
+    gpuProfiler.release();
+    framePacer.release();
+    renderTarget.release();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    headlessContext.destroy();
     glfwTerminate();
     return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// parse command line options
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+void parseArguments(int argc, char* argv[])
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--cubes") == 0 && i + 1 < argc)
+            stressCubes = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--animate") == 0)
+            stressAnimate = true;
+        else if (std::strcmp(argv[i], "--no-cull") == 0)
+            frustumCulling = false;
+        else if (std::strcmp(argv[i], "--bench-cull") == 0)
+            cullBenchmark = true;
+        else if (std::strcmp(argv[i], "--bvh-cull") == 0)
+            bvhCulling = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            frameThreads = std::min((unsigned int)std::strtoul(argv[++i], NULL, 10), RenderQueue::MAX_DRAW_LISTS);  // a draw list per thread
+        else if (std::strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc)
+            simulationRate = std::max(1.0f, (float)std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--latency") == 0)
+            latencyMode = true;
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+            framesInFlight = std::max(1u, std::min(FramePacer::MAX_FRAMES_IN_FLIGHT, (unsigned int)std::strtoul(argv[++i], NULL, 10)));
+        else if (std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)
+            fpsLimit = std::max(0.0, std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc)
+            swapInterval = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--gpu-profile") == 0 && i + 1 < argc)
+            gpuProfilePath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc)
+            hitchBudgetMs = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-profile") == 0)
+            cpuProfiling = false;
+        else if (std::strcmp(argv[i], "--headless") == 0)
+            headlessFrames = (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])) ? (unsigned int)std::strtoul(argv[++i], NULL, 10) : 600;
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight);
+        else if (std::strcmp(argv[i], "--hash") == 0)
+            headlessHash = true;
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-bindless") == 0)
+            allowBindless = false;
+        else if (std::strcmp(argv[i], "--fixed-step") == 0)
+            replayFixedStep = 1.0f / ((i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])) ? (float)std::atof(argv[++i]) : 60.0f);
+        else
+            std::cout << "unknown argument: " << argv[i] << " (usage: project [--cubes N] [--animate] [--no-cull] [--bvh-cull] [--bench-cull] [--threads N] [--sim-hz N] [--gpu-profile file.csv]"
+                      << " [--latency] [--frames-in-flight N] [--fps-limit N] [--swap-interval N]"
+                      << " [--trace file.json] [--hitch-ms N] [--no-profile] [--headless N] [--size WxH] [--hash]"
+                      << " [--record file] [--replay file] [--fixed-step [hz]] [--no-bindless])" << std::endl;
+    }
+}
+
+// --bench-cull: culling throughput per SIMD level (one thread) and with all culling threads,
+// on spheres scattered around a camera looking down -z; every level has to match scalar
+// ---------------------------------------------------------------------------------------------------------
+int benchmarkCulling()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    Frustum frustum = extractFrustum(projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    JobSystem jobs(frameThreads);
+    FrustumCuller culler(jobs);
+    std::cout << "frustum culling, M spheres/s (detected: " << cullLevelName(detectCullLevel()) << ", " << culler.threadCount() << " threads)" << std::endl;
+    for (size_t count : { (size_t)100000, (size_t)1000000 })
+    {
+        BoundingSpheres spheres;
+        spheres.resize(count);
+        std::mt19937 rng(1337);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> radius(0.5f, 2.0f);
+        for (size_t i = 0; i < count; i++)
+            spheres.set(i, glm::vec3(position(rng), position(rng), position(rng)), radius(rng));
+
+        std::vector<uint32_t> reference, visible(count);
+        for (int level = CULL_SCALAR; level <= (int)detectCullLevel(); level++)
+        {
+            cullLevel() = (CullLevel)level;
+            size_t visibleCount = 0;
+            double best = 1e30;
+            for (int run = 0; run < 5; run++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                visibleCount = cullSpheres(frustum, spheres, 0, count, visible.data());
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            visible.resize(visibleCount);
+            if (level == CULL_SCALAR)
+                reference = visible;
+            std::printf("%8zu spheres  %-8s 1 thread  %8.1f  (%zu visible)%s\n", count, cullLevelName((CullLevel)level), count / best / 1e6, visibleCount,
+                        visible == reference ? "" : "  MISMATCH against scalar");
+            visible.resize(count);
+        }
+
+        cullLevel() = detectCullLevel();
+        double best = 1e30;
+        bool match = true;
+        for (int run = 0; run < 5; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            match = culler.cull(frustum, spheres) == reference;
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::printf("%8zu spheres  %-8s %u threads %7.1f%s\n", count, cullLevelName(cullLevel()), culler.threadCount(), count / best / 1e6,
+                    match ? "" : "  MISMATCH against scalar");
 
+        // the same spheres in a BVH: build, hierarchical query (boxes, so a few more pass), ray casts
+        // and moving 1% of the objects a little
+        auto start = std::chrono::steady_clock::now();
+        DynamicBvh bvh;
+        std::vector<int> proxies(count);
+        for (size_t i = 0; i < count; i++)
+            proxies[i] = bvh.insert(sphereAabb(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]), (uint32_t)i);
+        double insertMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        float insertCost = bvh.sahCost();
+        start = std::chrono::steady_clock::now();
+        bvh.rebuild();
+        double rebuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8zu spheres  bvh: insert %.0f ms (SAH cost %.1f), rebuild %.0f ms (SAH cost %.1f, height %d)\n", count, insertMs, insertCost, rebuildMs, bvh.sahCost(), bvh.height());
+
+        std::vector<uint32_t> objects;
+        best = 1e30;
+        for (int run = 0; run < 5; run++)
+        {
+            start = std::chrono::steady_clock::now();
+            bvh.queryFrustum(frustum, objects);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(objects.begin(), objects.end());
+        bool covers = std::includes(objects.begin(), objects.end(), reference.begin(), reference.end());
+        std::printf("%8zu spheres  bvh query         %8.1f  (%zu visible, %.3f ms)%s\n", count, count / best / 1e6, objects.size(), best * 1e3,
+                    covers ? "" : "  MISSES spheres the kernels keep");
+
+        const int rays = 10000;
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        start = std::chrono::steady_clock::now();
+        unsigned int hits = 0;
+        for (int ray = 0; ray < rays; ray++)
+        {
+            glm::vec3 origin(position(rng), position(rng), position(rng));
+            glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 0.001f));
+            auto sphereHit = [&](uint32_t i) { return raySphere(origin, direction, glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]); };
+            BvhRayHit hit;
+            hits += bvh.raycast(origin, direction, 2000.0f, sphereHit, hit) ? 1 : 0;
+        }
+        double rayUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rays;
+        std::printf("%8zu spheres  bvh ray cast      %.2f us per ray (%u of %d hit)\n", count, rayUs, hits, rays);
+
+        std::uniform_real_distribution<float> nudge(-0.5f, 0.5f);
+        size_t moved = count / 100, reinserted = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t m = 0; m < moved; m++)
+        {
+            size_t i = rng() % count;
+            spheres.set(i, glm::vec3(spheres.x[i] + nudge(rng), spheres.y[i] + nudge(rng), spheres.z[i] + nudge(rng)), spheres.radius[i]);
+            reinserted += bvh.move(proxies[i], sphereAabb(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i])) ? 1 : 0;
+        }
+        double moveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        bvh.refit();
+        double refitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8zu spheres  bvh move %zu      %.2f ms (%zu reinserted), full refit %.2f ms\n", count, moved, moveMs, reinserted, refitMs);
+    }
+    return 0;
+}
+
+// query GLFW whether relevant keys are pressed/released this frame, as InputKey bits
+// ---------------------------------------------------------------------------------------------------------
+uint8_t readInputKeys(GLFWwindow* window)
+{
+    uint8_t keys = 0;
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        keys |= INPUT_KEY_EXIT;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        keys |= INPUT_KEY_FORWARD;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        keys |= INPUT_KEY_BACKWARD;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        keys |= INPUT_KEY_LEFT;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        keys |= INPUT_KEY_RIGHT;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+        keys |= INPUT_KEY_PICK;
+    return keys;
+}
+
+// process all input: react to the keys held this frame (live or from a replay)
+// ---------------------------------------------------------------------------------------------------------
+void processInput(GLFWwindow* window, uint8_t keys)
+{
+    if ((keys & INPUT_KEY_EXIT) && window)
+        glfwSetWindowShouldClose(window, true);
+
+    // movement happens in the simulation steps
+    heldKeys = keys;
+
+    // pick once per click, not every frame the button is held
+    if ((keys & INPUT_KEY_PICK) && !(previousKeys & INPUT_KEY_PICK))
+        pickRequested = true;
+    previousKeys = keys;
+}
+
+// one fixed simulation step: move the camera by the held keys
+// ---------------------------------------------------------------------------------------------------------
+void simulateStep(float step)
+{
+    if (heldKeys & INPUT_KEY_FORWARD)
+        camera.ProcessKeyboard(FORWARD, step);
+    if (heldKeys & INPUT_KEY_BACKWARD)
+        camera.ProcessKeyboard(BACKWARD, step);
+    if (heldKeys & INPUT_KEY_LEFT)
+        camera.ProcessKeyboard(LEFT, step);
+    if (heldKeys & INPUT_KEY_RIGHT)
+        camera.ProcessKeyboard(RIGHT, step);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -296,9 +1029,18 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
+    // during a replay the recording moves the camera, not the live mouse
+    if (inputReplay.replaying())
+        return;
+
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
+    inputRecorder.event(INPUT_EVENT_MOUSE, xpos, ypos);
+    mouseMoved(xpos, ypos);
+}
 
+void mouseMoved(float xpos, float ypos)
+{
     if (firstMouse)
     {
         lastX = xpos;
@@ -312,51 +1054,34 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
+    // mouse look is not simulated: the previous pose turns along, so it shows without interpolation
+    float yaw = camera.Yaw;
+    float pitch = camera.Pitch;
     camera.ProcessMouseMovement(xoffset, yoffset);
+    previousPose.yaw += camera.Yaw - yaw;
+    previousPose.pitch += camera.Pitch - pitch;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    if (inputReplay.replaying())
+        return;
+
+    inputRecorder.event(INPUT_EVENT_SCROLL, static_cast<float>(xoffset), static_cast<float>(yoffset));
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const* path)
+// replay: feed recorded mouse / scroll events through the same code the callbacks use
+// ----------------------------------------------------------------------
+void applyInputEvents(const std::vector<InputEvent>& events)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    for (const InputEvent& event : events)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        if (event.type == INPUT_EVENT_MOUSE)
+            mouseMoved(event.x, event.y);
+        else if (event.type == INPUT_EVENT_SCROLL)
+            camera.ProcessMouseScroll(event.y);
     }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_ext.h>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+// A program is stored under shader_cache/<key>.bin, where the key hashes the final shader
+// sources (so defines injected into them are covered too) together with the driver's
+// vendor, renderer and version strings: a driver update or a different GPU simply misses.
+// A binary the driver rejects is recompiled from source and overwritten.
+
+const uint32_t PROGRAM_CACHE_MAGIC = 0x4E425047;  // "GPBN"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+struct ProgramCacheStats
+{
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int rejected = 0;  // found but stale or refused by the driver
+};
+
+inline ProgramCacheStats& programCacheStats()
+{
+    static ProgramCacheStats stats;
+    return stats;
+}
+
+inline std::string& programCacheDirectory()
+{
+    static std::string directory = "shader_cache";
+    return directory;
+}
+
+// 64 bit FNV-1a
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull)
+{
+    // the terminator separates consecutive strings so "ab" + "c" != "a" + "bc"
+    return hashBytes(text.c_str(), text.size() + 1, hash);
+}
+
+// ------------------------------------------------------------------------
+inline uint64_t programCacheKey(const std::string& vertexCode, const std::string& fragmentCode)
+{
+    uint64_t hash = hashString((const char*)glGetString(GL_VENDOR));
+    hash = hashString((const char*)glGetString(GL_RENDERER), hash);
+    hash = hashString((const char*)glGetString(GL_VERSION), hash);
+    hash = hashString(vertexCode, hash);
+    return hashString(fragmentCode, hash);
+}
+
+inline std::string programCachePath(uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return programCacheDirectory() + "/" + name;
+}
+
+// ask the driver to keep the binary retrievable; call before glLinkProgram
+inline void prepareCachedProgram(GLuint program)
+{
+    if (glExtensions().programBinary)
+        glExtensions().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// link program from the cached binary; false (program left unlinked) when there is none or it is unusable
+// ------------------------------------------------------------------------
+inline bool loadCachedProgram(GLuint program, uint64_t key)
+{
+    const GLExtensions& ext = glExtensions();
+    std::ifstream file;
+    if (ext.programBinary)
+        file.open(programCachePath(key), std::ios::binary);
+    if (!file.is_open())
+    {
+        programCacheStats().misses++;
+        return false;
+    }
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    if (file.read((char*)&header, sizeof(header)) && header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION && header.key == key)
+    {
+        binary.resize(header.length);
+        file.read(binary.data(), binary.size());
+    }
+    GLint linked = GL_FALSE;
+    if (!binary.empty() && file)
+    {
+        ext.ProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked)
+    {
+        programCacheStats().rejected++;
+        return false;
+    }
+    programCacheStats().hits++;
+    return true;
+}
+
+// write the binary of a freshly linked program
+// ------------------------------------------------------------------------
+inline void storeCachedProgram(GLuint program, uint64_t key)
+{
+    const GLExtensions& ext = glExtensions();
+    if (!ext.programBinary)
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    ext.GetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(programCacheDirectory(), error);
+    // write to a temporary name first so a crash never leaves a truncated entry behind
+    std::string path = programCachePath(key);
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+        ProgramCacheHeader header = { PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, binaryFormat, (uint32_t)length };
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+            return;
+    }
+    std::filesystem::rename(path + ".tmp", path, error);
+}
+#endif
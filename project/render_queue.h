@@ -0,0 +1,281 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_ext.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\instancing.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_s.h>
+
+// Per-frame render queue. Objects submit one draw packet each (program, material, mesh and
+// their InstanceData) instead of drawing themselves; the queue radix-sorts the packets on a
+// 64-bit key and draws every run of packets sharing program and mesh as a single instanced
+// draw, so state changes and draw calls scale with the number of distinct combinations
+// rather than with the number of objects.
+//
+// Packets are recorded into DrawLists, one per recording thread, without any GL calls or
+// locking: worker threads fill their own list (drawList(thread)) while the GL thread uses list 0
+// through submit(). execute() then runs on the GL thread only and merges the lists in the sort.
+//
+// Every program drawn through the queue reads its model and normal matrices and its material
+// index from the per-instance attributes of instancing.h, and every mesh has to be attach()ed
+// once. Materials live in one storage buffer (see material_system.h), so they never split a
+// batch; the material index still takes part in the sort to keep equal materials together.
+
+enum RenderPass
+{
+    RENDER_PASS_OPAQUE = 0,       // sorted by state, then front to back
+    RENDER_PASS_TRANSPARENT = 1   // back to front only, drawn after everything opaque
+};
+
+// an indexed mesh in a VAO
+struct RenderMesh
+{
+    unsigned int vao = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+};
+
+// sort key, most significant field first:
+//   opaque:      pass (2) | program (12) | mesh (12) | material (14) | depth (24, near first)
+//   transparent: pass (2) | depth (24, far first) | program (12) | mesh (12) | material (14)
+// the fields only decide the order; batching compares the real program and mesh
+// ------------------------------------------------------------------------
+inline uint64_t renderSortKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int mesh, float depth)
+{
+    uint64_t quantized = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 16777215.0f);
+    uint64_t state = ((uint64_t)(program & 0xFFF) << 26) | ((uint64_t)(mesh & 0xFFF) << 14) | (material & 0x3FFF);
+    if (pass == RENDER_PASS_TRANSPARENT)
+        return ((uint64_t)pass << 62) | ((16777215 - quantized) << 38) | state;
+    return ((uint64_t)pass << 62) | (state << 24) | quantized;
+}
+
+struct RenderSortItem
+{
+    uint64_t key;
+    uint32_t index;  // draw list in the top bits, packet within it below (see RenderQueue)
+};
+
+// LSD radix sort, 8 bits per pass; passes where every key has the same byte are skipped,
+// so keys that only differ in a few fields cost a few passes. Stable, result in items.
+// ------------------------------------------------------------------------
+inline void radixSort(std::vector<RenderSortItem>& items, std::vector<RenderSortItem>& scratch)
+{
+    scratch.resize(items.size());
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256] = {};
+        for (const RenderSortItem& item : items)
+            counts[(item.key >> shift) & 0xFF]++;
+        if (counts[(items.empty() ? 0 : items[0].key >> shift) & 0xFF] == items.size())
+            continue;
+        size_t offset = 0;
+        for (size_t& count : counts)
+        {
+            size_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+        for (const RenderSortItem& item : items)
+            scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
+
+struct DrawPacket
+{
+    uint64_t key;
+    const Shader* shader;
+    const RenderMesh* mesh;
+    InstanceData instance;
+};
+
+// the packets one thread recorded this frame; a cache line of its own, since each is written
+// by a different thread
+// ------------------------------------------------------------------------
+class alignas(64) DrawList
+{
+public:
+    void submit(RenderPass pass, const Shader& shader, uint32_t material, const RenderMesh& mesh, const InstanceData& instance)
+    {
+        DrawPacket packet;
+        packet.shader = &shader;
+        packet.mesh = &mesh;
+        packet.instance = instance;
+        packet.instance.material = material;
+        float depth = glm::dot(depthRow, instance.model[3]);
+        packet.key = renderSortKey(pass, shader.ID, material, mesh.vao, depth);
+        packets.push_back(packet);
+    }
+    size_t size() const
+    {
+        return packets.size();
+    }
+
+private:
+    friend class RenderQueue;
+    std::vector<DrawPacket> packets;
+    glm::vec4 depthRow;
+};
+
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        unsigned int packets = 0;
+        unsigned int draws = 0;
+    };
+
+    static constexpr unsigned int MAX_DRAW_LISTS = 64;
+    static const unsigned int LIST_SHIFT = 26;  // up to 2^26 packets per list
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+    RenderQueue(unsigned int drawLists = 1)
+        : lists(std::max(1u, std::min(drawLists, MAX_DRAW_LISTS)))
+    {
+    }
+
+    // add the queue's per-instance attributes to a mesh's VAO
+    void attach(const RenderMesh& mesh)
+    {
+        instances.attach(mesh.vao);
+    }
+
+    // start a frame; depth in the sort key is the view-space distance divided by farPlane
+    // ------------------------------------------------------------------------
+    void begin(const glm::mat4& view, float farPlane)
+    {
+        glm::vec4 depthRow = glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]) / -farPlane;
+        for (DrawList& list : lists)
+        {
+            list.packets.clear();
+            list.depthRow = depthRow;
+        }
+    }
+
+    // the GL thread's list
+    void submit(RenderPass pass, const Shader& shader, uint32_t material, const RenderMesh& mesh, const InstanceData& instance)
+    {
+        lists[0].submit(pass, shader, material, mesh, instance);
+    }
+    // list for recording thread `thread` (0 is the GL thread's), between begin() and execute()
+    DrawList& drawList(unsigned int thread)
+    {
+        assert(thread < lists.size() && "more recording threads than draw lists");
+        return lists[thread];
+    }
+    unsigned int drawListCount() const
+    {
+        return (unsigned int)lists.size();
+    }
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const DrawList& list : lists)
+            total += list.size();
+        return total;
+    }
+
+    // sort, upload all instances in draw order with one buffer update and draw the batches
+    // ------------------------------------------------------------------------
+    void execute()
+    {
+        frameStats = Stats();
+        frameStats.packets = (unsigned int)size();
+        if (frameStats.packets == 0)
+            return;
+
+        items.clear();
+        for (uint32_t l = 0; l < (uint32_t)lists.size(); l++)
+        {
+            const std::vector<DrawPacket>& packets = lists[l].packets;
+            for (size_t i = 0; i < packets.size(); i++)
+                items.push_back({ packets[i].key, (l << LIST_SHIFT) | (uint32_t)i });
+        }
+        radixSort(items, scratch);
+
+        staging.resize(items.size());
+        for (size_t i = 0; i < items.size(); i++)
+            staging[i] = packet(items[i].index).instance;
+        instances.upload(staging.data(), (unsigned int)staging.size());
+
+        for (size_t first = 0; first < items.size();)
+        {
+            const DrawPacket& packet = this->packet(items[first].index);
+            size_t last = first + 1;
+            while (last < items.size() && batchable(packet, this->packet(items[last].index)))
+                last++;
+
+            packet.shader->use();
+            draw(*packet.mesh, (unsigned int)first, (GLsizei)(last - first));
+            frameStats.draws++;
+            first = last;
+        }
+
+        totalStats.packets += frameStats.packets;
+        totalStats.draws += frameStats.draws;
+        frames++;
+    }
+
+    const Stats& lastFrame() const
+    {
+        return frameStats;
+    }
+    void print(std::ostream& out) const
+    {
+        if (frames == 0)
+            return;
+        out << "render queue: " << (double)totalStats.packets / frames << " packets -> "
+            << (double)totalStats.draws / frames << " draws per frame, recorded into " << lists.size() << " draw lists"
+            << (glExtensions().baseInstance ? "" : " (no base instance: attributes re-pointed per draw)") << std::endl;
+    }
+
+    void release()
+    {
+        glDeleteBuffers(1, &instances.ID);
+        glState().bufferDeleted(instances.ID);
+    }
+
+private:
+    std::vector<DrawList> lists;
+    std::vector<RenderSortItem> items;
+    std::vector<RenderSortItem> scratch;
+    std::vector<InstanceData> staging;
+    InstanceBuffer instances;
+
+    Stats frameStats;
+    Stats totalStats;
+    unsigned int frames = 0;
+
+    const DrawPacket& packet(uint32_t index) const
+    {
+        return lists[index >> LIST_SHIFT].packets[index & ((1u << LIST_SHIFT) - 1)];
+    }
+
+    static bool batchable(const DrawPacket& a, const DrawPacket& b)
+    {
+        return a.shader == b.shader && a.mesh == b.mesh;
+    }
+
+    void draw(const RenderMesh& mesh, unsigned int firstInstance, GLsizei count)
+    {
+        glState().bindVertexArray(mesh.vao);
+        if (glExtensions().baseInstance)
+        {
+            glExtensions().DrawElementsInstancedBaseInstance(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0, count, firstInstance);
+            return;
+        }
+        instances.pointAttributes(firstInstance);
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0, count);
+    }
+};
+#endif
@@ -0,0 +1,27 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// per-instance attributes (see instancing.h), advanced once per instance
+layout (location = 3) in mat4 aModel;         // takes locations 3-6
+layout (location = 7) in mat3 aNormalMatrix;  // takes locations 7-9
+layout (location = 10) in uint aMaterial;      // index into the material storage buffer
+
+#include "common.glsl"
+
+out vec3 Normal;
+out vec3 FragPos;  
+out vec2 TexCoords;
+flat out uint MaterialIndex;
+
+void main()
+{
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+
+    // the normal matrix is computed per instance on the CPU, just like the model matrix
+    Normal = aNormalMatrix * aNormal;
+
+    TexCoords = aTexCoords;
+    MaterialIndex = aMaterial;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\job_system.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_s.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_watcher.h>
+
+// material features a program can be specialised for; each bit injects one define
+enum ShaderFeature
+{
+    FEATURE_SPECULAR_MAP = 1 << 0,  // HAS_SPECULAR_MAP
+    FEATURE_EMISSION_MAP = 1 << 1,  // HAS_EMISSION_MAP
+    FEATURE_BINDLESS_TEXTURES = 1 << 2,  // BINDLESS_TEXTURES: material maps are bindless handles
+};
+
+inline std::vector<std::string> shaderFeatureDefines(unsigned int features)
+{
+    static const char* names[] = { "HAS_SPECULAR_MAP", "HAS_EMISSION_MAP", "BINDLESS_TEXTURES" };
+    std::vector<std::string> defines;
+    for (unsigned int bit = 0; bit < sizeof(names) / sizeof(names[0]); bit++)
+        if (features & (1u << bit))
+            defines.push_back(names[bit]);
+    return defines;
+}
+
+// one vertex/fragment pair built once per feature combination actually requested, so a
+// material only runs the code (and texture fetches) for the maps it has. Programs are built
+// on first use, go through the program binary cache like any Shader and, when a watcher is
+// given, are hot reloaded with the rest.
+class ShaderPermutations
+{
+public:
+    // setup runs once on every new permutation, e.g. to assign sampler units
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath, std::function<void(Shader&)> setup = nullptr, ShaderWatcher* watcher = NULL)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), setup(setup), watcher(watcher)
+    {
+    }
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // ------------------------------------------------------------------------
+    Shader& get(unsigned int features)
+    {
+        std::unique_ptr<Shader>& shader = programs[features];
+        if (!shader)
+            build(features, readShaderSources(vertexPath, fragmentPath, shaderFeatureDefines(features)));
+        return *shader;
+    }
+
+    // build permutations ahead of time instead of on their first draw. With a job system the
+    // source files are read and preprocessed as background jobs, all at once; compiling stays
+    // on the GL thread
+    // ------------------------------------------------------------------------
+    void warm(const std::vector<unsigned int>& featureSets, JobSystem* jobs = NULL)
+    {
+        if (jobs == NULL)
+        {
+            for (unsigned int features : featureSets)
+                get(features);
+            return;
+        }
+        std::vector<ShaderSources> sources(featureSets.size());
+        JobCounter reads;
+        for (size_t i = 0; i < featureSets.size(); i++)
+        {
+            if (programs.count(featureSets[i]))
+                continue;
+            jobs->schedule([this, &sources, &featureSets, i](unsigned int)
+            {
+                PROFILE_ZONE("read shader");
+                sources[i] = readShaderSources(vertexPath, fragmentPath, shaderFeatureDefines(featureSets[i]));
+            }, &reads, NULL, JOB_QUEUE_BACKGROUND);
+        }
+        jobs->wait(reads);
+        for (size_t i = 0; i < featureSets.size(); i++)
+            if (!programs.count(featureSets[i]))
+                build(featureSets[i], sources[i]);
+    }
+
+    // ------------------------------------------------------------------------
+    size_t size() const
+    {
+        return programs.size();
+    }
+    template <typename Function>
+    void forEach(Function function) const
+    {
+        for (const auto& program : programs)
+            function(*program.second);
+    }
+    void release()
+    {
+        for (auto& program : programs)
+        {
+            glDeleteProgram(program.second->ID);
+            glState().programDeleted(program.second->ID);
+        }
+        programs.clear();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::function<void(Shader&)> setup;
+    ShaderWatcher* watcher;
+    std::map<unsigned int, std::unique_ptr<Shader>> programs;
+
+    void build(unsigned int features, const ShaderSources& sources)
+    {
+        std::unique_ptr<Shader>& shader = programs[features];
+        shader.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), shaderFeatureDefines(features), sources));
+        if (setup)
+        {
+            shader->use();
+            setup(*shader);
+        }
+        if (watcher)
+            watcher->add(*shader);
+    }
+};
+#endif
@@ -0,0 +1,112 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// GLSL preprocessing done before a shader is handed to the driver:
+//  - #include "file" is replaced by the file's contents (paths relative to the including file,
+//    every file included at most once per stage)
+//  - feature defines are injected right after #version, so #ifdef blocks of unused features
+//    are compiled out of that permutation
+//  - #line directives keep compiler error lines pointing at the right file: the source string
+//    number in an error message is the file's index in the returned file list
+
+// ------------------------------------------------------------------------
+inline bool readShaderFile(const std::string& path, std::string& code)
+{
+    std::ifstream file;
+    // ensure ifstream objects can throw exceptions:
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        file.open(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        code = stream.str();
+    }
+    catch (std::ifstream::failure& e)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// the file name of an #include line, or an empty string for any other line
+inline std::string includeTarget(const std::string& line)
+{
+    std::string::size_type start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        return std::string();
+    std::string::size_type open = line.find_first_of("\"<", start + 8);
+    if (open == std::string::npos)
+        return std::string();
+    std::string::size_type close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string::npos)
+        return std::string();
+    return line.substr(open + 1, close - open - 1);
+}
+
+// append a file (and, recursively, its includes) to code
+// ------------------------------------------------------------------------
+inline bool appendShaderFile(const std::string& path, const std::vector<std::string>& defines, std::string& code, std::vector<std::string>& files)
+{
+    std::string source;
+    if (!readShaderFile(path, source))
+        return false;
+    int fileIndex = (int)files.size();
+    files.push_back(path);
+
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::string include = includeTarget(line);
+        if (!include.empty())
+        {
+            std::string includePath = (std::filesystem::path(path).parent_path() / include).lexically_normal().generic_string();
+            bool seen = false;
+            for (const std::string& file : files)
+                seen = seen || file == includePath;
+            if (!seen)
+            {
+                code += "#line 1 " + std::to_string(files.size()) + "\n";
+                if (!appendShaderFile(includePath, defines, code, files))
+                    return false;
+            }
+            code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        code += line;
+        code += "\n";
+        if (fileIndex == 0 && line.compare(0, 8, "#version") == 0)
+        {
+            for (const std::string& define : defines)
+                code += "#define " + define + " 1\n";
+            code += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+        }
+    }
+    return true;
+}
+
+// preprocess the shader stage at path; files receives every file it was built from
+// ------------------------------------------------------------------------
+inline bool preprocessShader(const std::string& path, const std::vector<std::string>& defines, std::string& code, std::vector<std::string>& files)
+{
+    code.clear();
+    files.clear();
+    return appendShaderFile(path, defines, code, files);
+}
+#endif
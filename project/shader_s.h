@@ -7,139 +7,411 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\program_cache.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_preprocessor.h>
+
+// the preprocessed code of both stages and every file it was read from. Reading it makes no GL
+// calls, so it can be done on any thread (see ShaderPermutations::warm)
+struct ShaderSources
+{
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::vector<std::string> files;
+    bool ok = false;
+};
+
+// ------------------------------------------------------------------------
+inline ShaderSources readShaderSources(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+{
+    ShaderSources sources;
+    std::vector<std::string> fragmentFiles;
+    sources.ok = preprocessShader(vertexPath, defines, sources.vertexCode, sources.files);
+    sources.ok = preprocessShader(fragmentPath, defines, sources.fragmentCode, fragmentFiles) && sources.ok;
+    for (const std::string& file : fragmentFiles)
+        if (std::find(sources.files.begin(), sources.files.end(), file) == sources.files.end())
+            sources.files.push_back(file);
+    return sources;
+}
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
-    // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+    // constructor generates the shader on the fly; each define is injected as "#define NAME 1"
+    // into both stages (see shader_preprocessor.h)
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>())
+        : Shader(vertexPath, fragmentPath, defines, readShaderSources(vertexPath, fragmentPath, defines))
+    {
+    }
+    // the same from sources already read with readShaderSources()
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines, const ShaderSources& sources)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines), files(sources.files), reloading(false)
+    {
+        // link from the program binary cache, or compile and link the sources
+        PendingProgram build = startProgram(sources.vertexCode, sources.fragmentCode);
+        finishProgram(build);
+        ID = build.program;
+        loadUniforms();
     }
-    // activate the shader
+    // activate the shader (skipped by the state cache when it is already current)
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        glState().useProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    // uniform locations are looked up once at link time (see loadUniforms) and every
+    // setter keeps a CPU copy of the last value it sent, so re-setting an unchanged
+    // value never reaches the driver. Like glUniform*, the setters expect use() first.
+    void setBool(const char* name, bool value) const
+    {
+        int v = (int)value;
+        setUniform(name, &v, sizeof(v), [&](GLint location) { glUniform1i(location, v); });
+    }
+    // ------------------------------------------------------------------------
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setUniform(name, &value, sizeof(value), [&](GLint location) { glUniform1i(location, value); });
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setUniform(name, &value, sizeof(value), [&](GLint location) { glUniform1f(location, value); });
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setVec2(const char* name, const glm::vec2& value) const
+    {
+        setUniform(name, &value[0], sizeof(float) * 2, [&](GLint location) { glUniform2fv(location, 1, &value[0]); });
+    }
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setVec2(name, glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(name, &value[0], sizeof(float) * 3, [&](GLint location) { glUniform3fv(location, 1, &value[0]); });
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setVec3(name, glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(name, &value[0], sizeof(float) * 4, [&](GLint location) { glUniform4fv(location, 1, &value[0]); });
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec4(name, glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(name, &mat[0][0], sizeof(float) * 4, [&](GLint location) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); });
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    // ------------------------------------------------------------------------
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setUniform(name, &mat[0][0], sizeof(float) * 9, [&](GLint location) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); });
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(name, &mat[0][0], sizeof(float) * 16, [&](GLint location) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); });
     }
+
+    // uniform upload statistics: uploads that went to the driver vs. ones skipped because the value was unchanged
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    struct UniformStats
+    {
+        unsigned long long sent = 0;
+        unsigned long long skipped = 0;
+    };
+    const UniformStats& uniformStats() const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        return stats;
     }
+    void resetUniformStats()
+    {
+        stats = UniformStats();
+    }
+
+    // hot reload: re-read the sources and rebuild them into a new program. With
+    // KHR_parallel_shader_compile the compile runs on driver threads and updateReload()
+    // polls it without blocking; otherwise it completes on the next updateReload().
+    // The new program replaces ID only after it linked; on any error the old one stays.
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void reload()
+    {
+        discardReload();
+        // keep the previous file list when a file is missing mid-save, so it stays watched
+        ShaderSources sources = readShaderSources(vertexPath, fragmentPath, defines);
+        if (!sources.ok)
+            return;
+        files = sources.files;
+        pending = startProgram(sources.vertexCode, sources.fragmentCode);
+        reloading = true;
+    }
+    // call once per frame while reloadPending(); true when the new program was swapped in
+    bool updateReload()
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (!reloading)
+            return false;
+        if (glExtensions().parallelShaderCompile && !pending.fromCache)
+        {
+            GLint done = GL_FALSE;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done)
+                return false;
+        }
+        reloading = false;
+        if (!finishProgram(pending))
+        {
+            std::cout << "ERROR::SHADER::RELOAD_FAILED, keeping the previous program: " << vertexPath << " + " << fragmentPath << std::endl;
+            glDeleteProgram(pending.program);
+            glState().programDeleted(pending.program);
+            return false;
+        }
+        unsigned int oldProgram = ID;
+        ID = pending.program;
+        // the new program starts with default uniform values: look its uniforms up again and
+        // re-send every value the old program had been given, so e.g. sampler units survive.
+        // The old program is deleted only afterwards, once nothing can bind it again
+        std::vector<UniformSlot> previous;
+        previous.swap(uniforms);
+        loadUniforms();
+        restoreUniforms(previous, oldProgram);
+        glDeleteProgram(oldProgram);
+        glState().programDeleted(oldProgram);
+        std::cout << "reloaded " << vertexPath << " + " << fragmentPath << std::endl;
+        return true;
+    }
+    bool reloadPending() const
+    {
+        return reloading;
+    }
+    void discardReload()
+    {
+        if (!reloading)
+            return;
+        glDeleteShader(pending.vertex);
+        glDeleteShader(pending.fragment);
+        glDeleteProgram(pending.program);
+        glState().programDeleted(pending.program);
+        reloading = false;
+    }
+    // files the program is built from, includes too, for the shader watcher
+    const std::vector<std::string>& sourceFiles() const
+    {
+        return files;
     }
 
 private:
+    // a program being built: compile and link are issued by startProgram() and only
+    // checked in finishProgram(), so a parallel-compiling driver can work in between
+    struct PendingProgram
+    {
+        unsigned int program = 0;
+        unsigned int vertex = 0;
+        unsigned int fragment = 0;
+        uint64_t key = 0;
+        bool fromCache = false;
+    };
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> defines;
+    std::vector<std::string> files;
+    PendingProgram pending;
+    bool reloading;
+
+    // ------------------------------------------------------------------------
+    static PendingProgram startProgram(const std::string& vertexCode, const std::string& fragmentCode)
+    {
+        PendingProgram build;
+        build.program = glCreateProgram();
+        build.key = programCacheKey(vertexCode, fragmentCode);
+        if (loadCachedProgram(build.program, build.key))
+        {
+            build.fromCache = true;
+            return build;
+        }
+        const char* vShaderCode = vertexCode.c_str();
+        const char* fShaderCode = fragmentCode.c_str();
+        // vertex shader
+        build.vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+        glCompileShader(build.vertex);
+        // fragment Shader
+        build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+        glCompileShader(build.fragment);
+        // shader Program
+        glAttachShader(build.program, build.vertex);
+        glAttachShader(build.program, build.fragment);
+        prepareCachedProgram(build.program);
+        glLinkProgram(build.program);
+        return build;
+    }
+    // report errors and cache the binary; true if the program linked
+    static bool finishProgram(PendingProgram& build)
+    {
+        if (build.fromCache)
+            return true;
+        checkCompileErrors(build.vertex, "VERTEX");
+        checkCompileErrors(build.fragment, "FRAGMENT");
+        bool linked = checkCompileErrors(build.program, "PROGRAM");
+        if (linked)
+            storeCachedProgram(build.program, build.key);
+        // delete the shaders as they're linked into our program now and no longer necessary
+        glDetachShader(build.program, build.vertex);
+        glDetachShader(build.program, build.fragment);
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+        return linked;
+    }
+
+    // one entry per active uniform (array elements get their own entry), sorted by name.
+    // the bare name of an array is an alias: it forwards to the "name[0]" entry, so there is
+    // only one cached value per location.
+    struct UniformSlot
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        int target;     // index of the entry an alias forwards to, -1 for a real entry
+        bool cached;
+        unsigned char value[sizeof(float) * 16];  // large enough for a mat4
+    };
+    mutable std::vector<UniformSlot> uniforms;
+    mutable UniformStats stats;
+
+    // read every active uniform of the linked program into the location table.
+    // uniforms that live in a uniform block have no location and are left out.
+    // ------------------------------------------------------------------------
+    void loadUniforms()
+    {
+        uniforms.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLuint i = 0; i < (GLuint)count; i++)
+        {
+            GLint size = 0, blockIndex = -1;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), NULL, &size, &type, nameBuffer.data());
+            glGetActiveUniformsiv(ID, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+            if (blockIndex != -1)
+                continue;
+
+            std::string name = nameBuffer.data();
+            std::string::size_type bracket = name.find("[0]");
+            if (bracket == std::string::npos || bracket + 3 != name.size())
+            {
+                addUniform(name, glGetUniformLocation(ID, name.c_str()), type);
+                continue;
+            }
+            // arrays are reported once as "name[0]"; register every element and the bare name as an alias
+            std::string base = name.substr(0, bracket);
+            addUniform(base, glGetUniformLocation(ID, name.c_str()), type, true);
+            for (GLint element = 0; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()), type);
+            }
+        }
+        std::sort(uniforms.begin(), uniforms.end(), [](const UniformSlot& a, const UniformSlot& b) { return a.name < b.name; });
+        // aliases can only be resolved once the table is sorted
+        for (UniformSlot& slot : uniforms)
+        {
+            if (slot.target == -1)
+                continue;
+            slot.target = -1;
+            UniformSlot* element = findUniform((slot.name + "[0]").c_str());
+            slot.target = element != NULL ? (int)(element - uniforms.data()) : -1;
+        }
+    }
+    void addUniform(const std::string& name, GLint location, GLenum type, bool alias = false)
+    {
+        if (location == -1)
+            return;
+        UniformSlot slot;
+        slot.name = name;
+        slot.location = location;
+        slot.type = type;
+        slot.target = alias ? 0 : -1;
+        slot.cached = false;
+        uniforms.push_back(slot);
+    }
+    // re-send the cached values of a previous program to the matching uniforms of this one;
+    // if the previous program was the bound one, this one stays bound in its place
+    void restoreUniforms(const std::vector<UniformSlot>& previous, GLuint previousProgram)
+    {
+        GLuint current = glState().currentProgram();
+        glState().useProgram(ID);
+        for (const UniformSlot& old : previous)
+        {
+            UniformSlot* slot = findUniform(old.name.c_str());
+            if (!old.cached || slot == NULL || slot->type != old.type)
+                continue;
+            std::memcpy(slot->value, old.value, sizeof(slot->value));
+            slot->cached = true;
+            const float* f = (const float*)slot->value;
+            switch (slot->type)
+            {
+            case GL_FLOAT:      glUniform1fv(slot->location, 1, f); break;
+            case GL_FLOAT_VEC2: glUniform2fv(slot->location, 1, f); break;
+            case GL_FLOAT_VEC3: glUniform3fv(slot->location, 1, f); break;
+            case GL_FLOAT_VEC4: glUniform4fv(slot->location, 1, f); break;
+            case GL_FLOAT_MAT2: glUniformMatrix2fv(slot->location, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT3: glUniformMatrix3fv(slot->location, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT4: glUniformMatrix4fv(slot->location, 1, GL_FALSE, f); break;
+            default:            glUniform1iv(slot->location, 1, (const GLint*)slot->value); break;  // int, bool, samplers
+            }
+        }
+        if (current != GLStateCache::UNKNOWN && current != previousProgram)
+            glState().useProgram(current);
+    }
+    // binary search by name, following aliases; no allocation for string literals
+    UniformSlot* findUniform(const char* name) const
+    {
+        auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+            [](const UniformSlot& slot, const char* key) { return std::strcmp(slot.name.c_str(), key) < 0; });
+        if (it == uniforms.end() || std::strcmp(it->name.c_str(), name) != 0)
+            return NULL;
+        return it->target >= 0 ? &uniforms[it->target] : &*it;
+    }
+    // compare against the cached copy and only call upload() when the value changed.
+    // names that are not active in this program are ignored, just like location -1 would be.
+    template <typename Upload>
+    void setUniform(const char* name, const void* value, size_t size, Upload upload) const
+    {
+        UniformSlot* slot = findUniform(name);
+        if (slot == NULL)
+            return;
+        if (slot->cached && std::memcmp(slot->value, value, size) == 0)
+        {
+            stats.skipped++;
+            return;
+        }
+        std::memcpy(slot->value, value, size);
+        slot->cached = true;
+        stats.sent++;
+        upload(slot->location);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -161,6 +433,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 #endif
\ No newline at end of file
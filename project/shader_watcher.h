@@ -0,0 +1,155 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\shader_s.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// watches the source files of registered shaders and hot reloads a shader when one of them
+// changes. On Linux the directories are watched with inotify (editors often save by renaming
+// a temporary file, so whole directories are watched rather than the files); elsewhere the
+// modification times are polled a few times per second. update() runs on the GL thread.
+class ShaderWatcher
+{
+public:
+    ShaderWatcher()
+    {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+        lastPoll = std::chrono::steady_clock::now();
+    }
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // ------------------------------------------------------------------------
+    void add(Shader& shader)
+    {
+        shaders.push_back(&shader);
+        watchFiles(shader);
+    }
+
+    // start reloads for changed files and finish the ones in flight; the number of programs swapped in
+    // ------------------------------------------------------------------------
+    int update()
+    {
+        std::set<Shader*> changed;
+        for (const std::string& path : changedFiles())
+            for (Shader* shader : watchers[path])
+                changed.insert(shader);
+        for (Shader* shader : changed)
+            shader->reload();
+
+        int swapped = 0;
+        for (Shader* shader : shaders)
+            if (shader->reloadPending() && shader->updateReload())
+            {
+                watchFiles(*shader);  // the edit may have added an #include
+                swapped++;
+            }
+        return swapped;
+    }
+
+private:
+    std::vector<Shader*> shaders;
+    std::map<std::string, std::vector<Shader*>> watchers;  // source file -> shaders built from it
+    std::map<std::string, std::filesystem::file_time_type> times;
+    std::chrono::steady_clock::time_point lastPoll;
+#ifdef __linux__
+    int fd;
+    std::set<std::string> watchedDirectories;
+    std::map<int, std::string> directories;  // watch descriptor -> directory
+#endif
+
+    void watchFiles(Shader& shader)
+    {
+        for (const std::string& file : shader.sourceFiles())
+        {
+            std::string path = normalize(file);
+            std::vector<Shader*>& watching = watchers[path];
+            if (std::find(watching.begin(), watching.end(), &shader) != watching.end())
+                continue;
+            watching.push_back(&shader);
+            std::error_code error;
+            times[path] = std::filesystem::last_write_time(path, error);
+#ifdef __linux__
+            std::string directory = std::filesystem::path(path).parent_path().string();
+            if (fd >= 0 && watchedDirectories.insert(directory).second)
+            {
+                int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd >= 0)
+                    directories[wd] = directory;
+            }
+#endif
+        }
+    }
+
+    static std::string normalize(const std::string& file)
+    {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::absolute(file, error);
+        return path.lexically_normal().generic_string();
+    }
+
+    std::vector<std::string> changedFiles()
+    {
+        std::vector<std::string> changed;
+#ifdef __linux__
+        if (fd >= 0)
+        {
+            alignas(struct inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* p = buffer; p < buffer + length;)
+                {
+                    const struct inotify_event* event = (const struct inotify_event*)p;
+                    if (event->len > 0 && directories.count(event->wd))
+                    {
+                        std::string path = normalize(directories[event->wd] + "/" + event->name);
+                        if (watchers.count(path))
+                            changed.push_back(path);
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            return changed;
+        }
+#endif
+        // no change notifications: compare modification times every 250 ms
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastPoll < std::chrono::milliseconds(250))
+            return changed;
+        lastPoll = now;
+        for (auto& entry : times)
+        {
+            std::error_code error;
+            std::filesystem::file_time_type time = std::filesystem::last_write_time(entry.first, error);
+            if (!error && time != entry.second)
+            {
+                entry.second = time;
+                changed.push_back(entry.first);
+            }
+        }
+        return changed;
+    }
+};
+#endif
@@ -0,0 +1,95 @@
+#ifndef STRESS_SCENE_H
+#define STRESS_SCENE_H
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <C:\hLib\glProject\LearnOpenGL\project\instancing.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\frustum_culling.h>
+
+// a configurable field of cubes for finding the vertex- and CPU-bound limits of the lighting shader.
+// Each cube is stored compactly (position, scale, rotation axis and speed) and expanded into
+// InstanceData on update(); animated scenes do that every frame, static ones only once.
+// The cubes only rotate in place, so their bounding spheres (for culling) are set once in build().
+class StressScene
+{
+public:
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> axes;
+    std::vector<float> scales;
+    std::vector<float> speeds;
+    std::vector<InstanceData> instances;
+    BoundingSpheres bounds;
+    bool animated;
+
+    StressScene() : animated(false)
+    {
+    }
+
+    // lay the cubes out on a jittered grid in front of the starting camera position
+    // ------------------------------------------------------------------------
+    void build(unsigned int count, bool animate, unsigned int seed = 1337)
+    {
+        animated = animate;
+        positions.resize(count);
+        axes.resize(count);
+        scales.resize(count);
+        speeds.resize(count);
+        instances.resize(count);
+        bounds.resize(count);
+
+        const float spacing = 1.5f;
+        unsigned int side = (unsigned int)std::ceil(std::cbrt((double)count));
+        glm::vec3 origin(-0.5f * spacing * side, -0.5f * spacing * side, -spacing * side - 5.0f);
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> jitter(-0.25f, 0.25f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> scale(0.3f, 0.8f);
+        std::uniform_real_distribution<float> speed(0.2f, 2.0f);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 cell((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+            positions[i] = origin + cell * spacing + glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+            glm::vec3 axis(unit(rng), unit(rng), unit(rng));
+            axes[i] = glm::length(axis) > 0.001f ? glm::normalize(axis) : glm::vec3(0.0f, 1.0f, 0.0f);
+            scales[i] = scale(rng);
+            speeds[i] = speed(rng);
+            bounds.set(i, positions[i], 0.8660254f * scales[i]);  // half the diagonal of the scaled unit cube
+        }
+        update(0.0f);
+    }
+
+    // expand the compact description into model and normal matrices (uniform scale: no inverse needed)
+    // ------------------------------------------------------------------------
+    void update(float time)
+    {
+        for (size_t i = 0; i < positions.size(); i++)
+            updateCube(i, time);
+    }
+    // only the listed cubes, e.g. the ones that survived culling; lists that do not overlap can be
+    // updated from different threads
+    void update(float time, const uint32_t* indices, size_t count)
+    {
+        for (size_t k = 0; k < count; k++)
+            updateCube(indices[k], time);
+    }
+
+    unsigned int size() const
+    {
+        return (unsigned int)positions.size();
+    }
+
+private:
+    void updateCube(size_t i, float time)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+        model = glm::rotate(model, time * speeds[i], axes[i]);
+        model = glm::scale(model, glm::vec3(scales[i]));
+        instances[i].model = model;
+        instances[i].normal = glm::mat3(model);
+    }
+};
+#endif
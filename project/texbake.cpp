@@ -0,0 +1,157 @@
+// texbake: offline texture baking tool.
+// Decodes an image, builds the full mip chain and writes a GPU-ready .gtex container (see
+// texture_container.h) that TextureLoader uploads without decoding or generating mips at runtime.
+//
+// usage: texbake <input image> <output.gtex> [--channel diffuse|specular|emission] [--uncompressed]
+//                [--kaiser] [--premultiply] [--mask-channel r|g|b|a]
+//        texbake --bench [width height]   times the image kernels at every SIMD level against scalar
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <C:\hLib\glProject\LearnOpenGL\project\texture_bake.h>
+
+// best of a few runs, in megapixels per second
+double measure(size_t pixels, const std::function<void()>& kernel)
+{
+    double best = 1e30;
+    for (int run = 0; run < 5; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        kernel();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return pixels / best / 1e6;
+}
+
+int benchmark(int width, int height)
+{
+    size_t pixels = (size_t)width * height;
+    std::vector<unsigned char> rgb(pixels * 3), rgba(pixels * 4), scratch(pixels * 4), half((size_t)std::max(1, width / 2) * std::max(1, height / 2) * 4);
+    srand(1337);
+    for (unsigned char& value : rgb)
+        value = (unsigned char)(rand() & 0xFF);
+    for (unsigned char& value : rgba)
+        value = (unsigned char)(rand() & 0xFF);
+
+    std::cout << "image kernels, " << width << "x" << height << ", Mpixel/s (detected: " << imageKernelLevelName(detectImageKernelLevel()) << ")" << std::endl;
+    std::cout << "level    rgb->rgba  extract  premultiply  box srgb  box linear  kaiser srgb" << std::endl;
+    std::vector<unsigned char> reference[6];
+    for (int level = IMAGE_KERNELS_SCALAR; level <= (int)detectImageKernelLevel(); level++)
+    {
+        imageKernelLevel() = (ImageKernelLevel)level;
+        std::vector<unsigned char> results[6];
+        double rates[6];
+        rates[0] = measure(pixels, [&] { imageExpandRgbToRgba(rgb.data(), scratch.data(), pixels); });
+        results[0] = scratch;
+        rates[1] = measure(pixels, [&] { imageExtractChannel(rgba.data(), scratch.data(), pixels, 1); });
+        results[1].assign(scratch.begin(), scratch.begin() + pixels);
+        scratch = rgba;
+        imagePremultiplyAlpha(scratch.data(), pixels);
+        results[2] = scratch;
+        rates[2] = measure(pixels, [&] { imagePremultiplyAlpha(scratch.data(), pixels); });  // in place: the timing does not depend on the values
+        rates[3] = measure(pixels, [&] { imageDownsampleBox(rgba.data(), width, height, half.data(), true); });
+        results[3] = half;
+        rates[4] = measure(pixels, [&] { imageDownsampleBox(rgba.data(), width, height, half.data(), false); });
+        results[4] = half;
+        rates[5] = measure(pixels, [&] { imageDownsampleKaiser(rgba.data(), width, height, half.data(), true); });
+        results[5] = half;
+
+        std::printf("%-8s %9.0f %8.0f %12.0f %9.0f %11.0f %12.0f", imageKernelLevelName((ImageKernelLevel)level), rates[0], rates[1], rates[2], rates[3], rates[4], rates[5]);
+        bool match = true;
+        for (int k = 0; k < 6; k++)
+        {
+            if (level == IMAGE_KERNELS_SCALAR)
+                reference[k] = results[k];
+            else
+                match = match && results[k] == reference[k];
+        }
+        std::cout << (match ? "" : "  MISMATCH against scalar") << std::endl;
+    }
+    imageKernelLevel() = detectImageKernelLevel();
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--bench") == 0)
+        return benchmark(argc >= 4 ? std::atoi(argv[2]) : 2048, argc >= 4 ? std::atoi(argv[3]) : 2048);
+    if (argc < 3)
+    {
+        std::cout << "usage: texbake <input image> <output.gtex> [--channel diffuse|specular|emission] [--uncompressed]" << std::endl;
+        std::cout << "               [--kaiser] [--premultiply] [--mask-channel r|g|b|a]" << std::endl;
+        std::cout << "       texbake --bench [width height]" << std::endl;
+        return 1;
+    }
+    const char* input = argv[1];
+    const char* output = argv[2];
+    MaterialChannel channel = CHANNEL_DIFFUSE;
+    BakeOptions options;
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--channel") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "specular") == 0)
+                channel = CHANNEL_SPECULAR;
+            else if (std::strcmp(name, "emission") == 0)
+                channel = CHANNEL_EMISSION;
+            else if (std::strcmp(name, "diffuse") != 0)
+            {
+                std::cout << "unknown channel: " << name << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--uncompressed") == 0)
+            options.compress = false;
+        else if (std::strcmp(argv[i], "--kaiser") == 0)
+            options.filter = MIP_FILTER_KAISER;
+        else if (std::strcmp(argv[i], "--premultiply") == 0)
+            options.premultiply = true;
+        else if (std::strcmp(argv[i], "--mask-channel") == 0 && i + 1 < argc)
+        {
+            const char* channels = "rgba";
+            const char* name = argv[++i];
+            const char* found = std::strchr(channels, name[0]);
+            if (!found || name[0] == 0 || name[1] != 0)
+            {
+                std::cout << "unknown mask channel: " << name << std::endl;
+                return 1;
+            }
+            options.maskChannel = (int)(found - channels);
+        }
+        else
+        {
+            std::cout << "unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    int width, height, nrComponents;
+    unsigned char* data = stbi_load(input, &width, &height, &nrComponents, 4);
+    if (!data)
+    {
+        std::cout << "failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+    RgbaImage image;
+    image.width = (uint32_t)width;
+    image.height = (uint32_t)height;
+    image.pixels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    if (!bakeTexture(image, channel, options, output))
+    {
+        std::cout << "failed to write " << output << std::endl;
+        return 1;
+    }
+    TextureFile baked;
+    readTextureFile(output, baked);
+    std::cout << input << " -> " << output << ": " << width << "x" << height << ", " << baked.header.levelCount
+              << " levels, " << baked.data.size() << " bytes (" << (size_t)width * height * 4 << " bytes uncompressed level 0)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,286 @@
+#ifndef TEXTURE_BAKE_H
+#define TEXTURE_BAKE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <C:\hLib\glProject\LearnOpenGL\project\image_kernels.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\texture_container.h>
+
+// offline texture baking: build the full mip chain of an RGBA8 image and encode every level
+// in the GPU format chosen for its material channel. Used by the texbake tool.
+
+enum MaterialChannel
+{
+    CHANNEL_DIFFUSE,    // colour          -> BC1
+    CHANNEL_SPECULAR,   // intensity mask  -> BC4, sampled as (r, r, r, 1)
+    CHANNEL_EMISSION,   // colour          -> BC1
+};
+
+struct RgbaImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<unsigned char> pixels;  // 4 bytes per pixel
+
+    const unsigned char* pixel(uint32_t x, uint32_t y) const
+    {
+        return &pixels[((size_t)y * width + x) * 4];
+    }
+};
+
+// mip filter used when baking (see image_kernels.h)
+enum MipFilter
+{
+    MIP_FILTER_BOX,     // 2x2 average
+    MIP_FILTER_KAISER,  // Kaiser-windowed sinc: sharper minification
+};
+
+struct BakeOptions
+{
+    bool compress = true;
+    MipFilter filter = MIP_FILTER_BOX;
+    bool premultiply = false;   // premultiply colour by alpha before filtering
+    int maskChannel = -1;       // specular: take the mask from this channel (0-3) instead of luminance
+};
+
+// halve an image; colour data (srgb) is filtered in linear space
+// ------------------------------------------------------------------------
+inline RgbaImage downsample(const RgbaImage& source, MipFilter filter, bool srgb)
+{
+    RgbaImage result;
+    result.width = std::max(1u, source.width / 2);
+    result.height = std::max(1u, source.height / 2);
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    if (filter == MIP_FILTER_KAISER)
+        imageDownsampleKaiser(source.pixels.data(), (int)source.width, (int)source.height, result.pixels.data(), srgb);
+    else
+        imageDownsampleBox(source.pixels.data(), (int)source.width, (int)source.height, result.pixels.data(), srgb);
+    return result;
+}
+
+// ------------------------------------------------------------------------
+inline std::vector<RgbaImage> buildMipChain(const RgbaImage& base, MipFilter filter, bool srgb)
+{
+    std::vector<RgbaImage> levels(1, base);
+    while (levels.back().width > 1 || levels.back().height > 1)
+        levels.push_back(downsample(levels.back(), filter, srgb));
+    return levels;
+}
+
+// gather a 4x4 block, clamping at the image edges
+inline void fetchBlock(const RgbaImage& image, uint32_t blockX, uint32_t blockY, unsigned char block[16][4])
+{
+    for (uint32_t y = 0; y < 4; y++)
+        for (uint32_t x = 0; x < 4; x++)
+            std::memcpy(block[y * 4 + x], image.pixel(std::min(blockX * 4 + x, image.width - 1), std::min(blockY * 4 + y, image.height - 1)), 4);
+}
+
+inline uint16_t packRgb565(const float color[3])
+{
+    int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRgb565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1: endpoints on the principal axis of the block's colours, inset slightly, four colour mode
+// ------------------------------------------------------------------------
+inline void encodeBlockBC1(const unsigned char block[16][4], unsigned char out[8])
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += block[i][c] / 16.0f;
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    // power iteration for the dominant eigenvector
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+            axis[c] = next[c] / length;
+    }
+    float minProjection = 1e30f, maxProjection = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    float inset = (maxProjection - minProjection) / 16.0f;
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++)
+    {
+        high[c] = mean[c] + axis[c] * (maxProjection - inset);
+        low[c] = mean[c] + axis[c] * (minProjection + inset);
+    }
+    uint16_t c0 = packRgb565(high), c1 = packRgb565(low);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int p0[3], p1[3], palette[4][3];
+        unpackRgb565(c0, p0);
+        unpackRgb565(c1, p1);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = p0[c];
+            palette[1][c] = p1[c];
+            palette[2][c] = (2 * p0[c] + p1[c]) / 3;
+            palette[3][c] = (p0[c] + 2 * p1[c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    out[0] = (unsigned char)(c0 & 0xFF); out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF); out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; b++)
+        out[4 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+// BC4: min/max endpoints, eight value mode, channel taken from component 0
+// ------------------------------------------------------------------------
+inline void encodeBlockBC4(const unsigned char block[16][4], unsigned char out[8])
+{
+    int high = 0, low = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        high = std::max(high, (int)block[i][0]);
+        low = std::min(low, (int)block[i][0]);
+    }
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        int palette[8] = { high, low };
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * high + p * low) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(block[i][0] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+// ------------------------------------------------------------------------
+inline std::vector<unsigned char> encodeLevel(const RgbaImage& image, uint32_t format)
+{
+    if (format == TEXTURE_FORMAT_RGBA8)
+        return image.pixels;
+
+    uint32_t blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    std::vector<unsigned char> encoded((size_t)blocksX * blocksY * 8);
+    unsigned char block[16][4];
+    for (uint32_t by = 0; by < blocksY; by++)
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            fetchBlock(image, bx, by, block);
+            unsigned char* out = &encoded[((size_t)by * blocksX + bx) * 8];
+            if (format == TEXTURE_FORMAT_BC1)
+                encodeBlockBC1(block, out);
+            else
+                encodeBlockBC4(block, out);
+        }
+    return encoded;
+}
+
+// bake an RGBA8 image for a material channel and write it as .gtex
+// ------------------------------------------------------------------------
+inline bool bakeTexture(const RgbaImage& image, MaterialChannel channel, const BakeOptions& options, const std::string& outputPath)
+{
+    RgbaImage base = image;
+    size_t pixelCount = (size_t)base.width * base.height;
+    uint32_t format = TEXTURE_FORMAT_RGBA8;
+    uint32_t flags = 0;
+    if (options.premultiply)
+        imagePremultiplyAlpha(base.pixels.data(), pixelCount);
+    if (channel == CHANNEL_SPECULAR)
+    {
+        // a specular map is an intensity mask: keep it (luminance, or one source channel) in the first channel
+        std::vector<unsigned char> mask(pixelCount);
+        if (options.maskChannel >= 0)
+            imageExtractChannel(base.pixels.data(), mask.data(), pixelCount, options.maskChannel);
+        else
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                const unsigned char* p = &base.pixels[i * 4];
+                mask[i] = (unsigned char)((p[0] * 77 + p[1] * 150 + p[2] * 29 + 128) >> 8);
+            }
+        for (size_t i = 0; i < pixelCount; i++)
+            base.pixels[i * 4] = base.pixels[i * 4 + 1] = base.pixels[i * 4 + 2] = mask[i];
+        if (options.compress)
+        {
+            format = TEXTURE_FORMAT_BC4;
+            flags = TEXTURE_FLAG_SWIZZLE_RRR;
+        }
+    }
+    else if (options.compress)
+        format = TEXTURE_FORMAT_BC1;
+
+    // colour maps are authored in sRGB: average them in linear space, masks as they are
+    std::vector<RgbaImage> mips = buildMipChain(base, options.filter, channel != CHANNEL_SPECULAR);
+    std::vector<std::vector<unsigned char>> levelData;
+    std::vector<TextureFileLevel> levels;
+    for (const RgbaImage& mip : mips)
+    {
+        levelData.push_back(encodeLevel(mip, format));
+        TextureFileLevel level = {};
+        level.width = mip.width;
+        level.height = mip.height;
+        levels.push_back(level);
+    }
+    return writeTextureFile(outputPath, format, flags, levelData, levels);
+}
+#endif
@@ -0,0 +1,145 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// ".gtex": a GPU-ready texture container written offline by texbake and loaded by TextureLoader.
+// It holds every mip level already in its final GPU format, so loading is a file read and a copy
+// into a pixel unpack buffer - no image decoding and no mip generation at runtime.
+//
+//   TextureFileHeader
+//   TextureFileLevel[levelCount]      largest level first
+//   level data, each level starting on a 16 byte boundary
+
+enum TextureFileFormat : uint32_t
+{
+    TEXTURE_FORMAT_RGBA8 = 1,   // uncompressed, 4 bytes per pixel
+    TEXTURE_FORMAT_BC1 = 2,     // RGB, 8 bytes per 4x4 block (GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+    TEXTURE_FORMAT_BC4 = 3,     // single channel, 8 bytes per 4x4 block (GL_COMPRESSED_RED_RGTC1)
+};
+
+enum TextureFileFlags : uint32_t
+{
+    TEXTURE_FLAG_SWIZZLE_RRR = 1,   // single channel data that should be sampled as (r, r, r, 1)
+};
+
+struct TextureFileHeader
+{
+    char magic[4];          // "GTEX"
+    uint32_t version;
+    uint32_t format;        // TextureFileFormat
+    uint32_t flags;         // TextureFileFlags
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct TextureFileLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;        // from the start of the file
+    uint64_t size;
+};
+
+const uint32_t TEXTURE_FILE_VERSION = 1;
+
+inline bool isBlockCompressed(uint32_t format)
+{
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4;
+}
+
+// bytes per 4x4 block for compressed formats, per pixel otherwise
+inline uint32_t textureFormatUnitBytes(uint32_t format)
+{
+    return isBlockCompressed(format) ? 8 : 4;
+}
+
+inline uint64_t textureLevelSize(uint32_t format, uint32_t width, uint32_t height)
+{
+    if (isBlockCompressed(format))
+        return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * textureFormatUnitBytes(format);
+    return (uint64_t)width * height * textureFormatUnitBytes(format);
+}
+
+// an in-memory .gtex file
+struct TextureFile
+{
+    TextureFileHeader header;
+    std::vector<TextureFileLevel> levels;
+    std::vector<unsigned char> data;  // the whole file, level offsets index into it
+};
+
+// ------------------------------------------------------------------------
+inline bool writeTextureFile(const std::string& path, uint32_t format, uint32_t flags,
+                             const std::vector<std::vector<unsigned char>>& levelData,
+                             const std::vector<TextureFileLevel>& levelSizes)
+{
+    TextureFileHeader header;
+    std::memcpy(header.magic, "GTEX", 4);
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = format;
+    header.flags = flags;
+    header.width = levelSizes.empty() ? 0 : levelSizes[0].width;
+    header.height = levelSizes.empty() ? 0 : levelSizes[0].height;
+    header.levelCount = (uint32_t)levelSizes.size();
+    header.reserved = 0;
+
+    std::vector<TextureFileLevel> levels = levelSizes;
+    uint64_t offset = sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * levels.size();
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        levels[i].offset = offset;
+        levels[i].size = levelData[i].size();
+        offset += levels[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(levels.data()), sizeof(TextureFileLevel) * levels.size());
+    uint64_t position = sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * levels.size();
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        static const char padding[16] = {};
+        file.write(padding, (std::streamsize)(levels[i].offset - position));
+        file.write(reinterpret_cast<const char*>(levelData[i].data()), (std::streamsize)levelData[i].size());
+        position = levels[i].offset + levels[i].size;
+    }
+    return (bool)file;
+}
+
+// read and validate a .gtex file; returns false for anything truncated or unknown
+// ------------------------------------------------------------------------
+inline bool readTextureFile(const std::string& path, TextureFile& texture)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    texture.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (texture.data.size() < sizeof(TextureFileHeader))
+        return false;
+    std::memcpy(&texture.header, texture.data.data(), sizeof(TextureFileHeader));
+    const TextureFileHeader& header = texture.header;
+    if (std::memcmp(header.magic, "GTEX", 4) != 0 || header.version != TEXTURE_FILE_VERSION || header.levelCount == 0 ||
+        (header.format != TEXTURE_FORMAT_RGBA8 && !isBlockCompressed(header.format)))
+        return false;
+    size_t tableEnd = sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * (size_t)header.levelCount;
+    if (texture.data.size() < tableEnd)
+        return false;
+    texture.levels.resize(header.levelCount);
+    std::memcpy(texture.levels.data(), texture.data.data() + sizeof(TextureFileHeader), sizeof(TextureFileLevel) * header.levelCount);
+    for (const TextureFileLevel& level : texture.levels)
+        if (level.offset + level.size > texture.data.size() || level.size != textureLevelSize(header.format, level.width, level.height))
+            return false;
+    return true;
+}
+#endif
@@ -0,0 +1,388 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\cpu_profiler.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\gl_state.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\image_kernels.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\job_system.h>
+#include <C:\hLib\glProject\LearnOpenGL\project\texture_container.h>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// one mip level inside ImageData::pixels
+struct ImageLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// pixels handed from a worker thread to the GL thread: a decoded image (RGB/RGBA with its mips
+// built on the worker, or one level of 1-2 channel data with mips generated on the GPU) or a baked
+// .gtex container (every level, possibly block compressed)
+struct ImageData
+{
+    GLenum internalFormat = GL_RGBA;
+    GLenum format = GL_RGBA;
+    bool compressed = false;
+    bool generateMips = true;
+    bool swizzleRed = false;            // sample single channel data as (r, r, r, 1)
+    std::vector<ImageLevel> levels;
+    std::vector<unsigned char> pixels;  // tightly packed rows (or rows of 4x4 blocks)
+    bool ok = false;
+
+    // uploads are split into rows: a row of pixels, or a row of 4x4 blocks for compressed formats
+    int rowHeight() const
+    {
+        return compressed ? 4 : 1;
+    }
+    int rowCount(int level) const
+    {
+        return (levels[level].height + rowHeight() - 1) / rowHeight();
+    }
+    size_t rowBytes(int level) const
+    {
+        return levels[level].size / rowCount(level);
+    }
+};
+
+// asynchronous texture loading: files are read and decoded as background jobs of the JobSystem,
+// preferring a baked .gtex file next to the source image (same name, see texbake.cpp) when one exists,
+// and each decoded image is handed to the GL thread as a main-thread job. The GL thread streams the decoded rows into the texture through a ring of pixel unpack buffers,
+// a few bands per frame, and only waits on nothing: a ring slot whose fence has not signalled yet
+// simply postpones the rest of the upload to the next frame. Until a texture is complete,
+// texture() returns a 1x1 grey placeholder so it can be bound from the first frame on.
+class TextureLoader
+{
+public:
+    // slotBytes is the size of one pixel unpack buffer, frameBudget the most bytes uploaded per update()
+    TextureLoader(JobSystem& jobs, size_t slotBytes = 4 << 20, unsigned int slotCount = 3, size_t frameBudget = 8 << 20)
+        : jobs(jobs), slotBytes(slotBytes), frameBudget(frameBudget), nextSlot(0)
+    {
+        // BC1 is an extension (BC4 is core): without it baked BC1 files are skipped in favour of the source image
+        supportsS3tc = false;
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++)
+            if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_texture_compression_s3tc") == 0)
+                supportsS3tc = true;
+
+        // placeholder bound until a texture is resident
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        glGenTextures(1, &placeholder);
+        glState().bindTexture(GL_TEXTURE_2D, placeholder);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        slots.resize(slotCount);
+        for (Slot& slot : slots)
+        {
+            glGenBuffers(1, &slot.pbo);
+            glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes, NULL, GL_STREAM_DRAW);
+            slot.fence = 0;
+        }
+        glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    ~TextureLoader()
+    {
+        // the jobs still in flight point at this loader
+        jobs.wait(loading);
+    }
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // queue a file for loading; returns a handle for texture().
+    // colorData: the image holds sRGB colour, so its mips are averaged in linear space (not for masks)
+    // ------------------------------------------------------------------------
+    unsigned int load(const char* path, bool colorData = true)
+    {
+        unsigned int handle = (unsigned int)requests.size();
+        requests.emplace_back(new Request());
+        Request* request = requests[handle].get();
+        request->path = path;
+        request->colorData = colorData;
+        // decode, then queue the upload on the GL thread; loading counts both jobs
+        jobs.schedule([this, handle, request](unsigned int)
+        {
+            {
+                PROFILE_ZONE("load texture");
+                if (!loadBaked(*request))
+                    decode(*request);
+            }
+            jobs.schedule([this, handle](unsigned int) { uploads.push_back(handle); }, &loading, NULL, JOB_QUEUE_MAIN_THREAD);
+        }, &loading, NULL, JOB_QUEUE_BACKGROUND);
+        return handle;
+    }
+
+    // the texture to bind for a handle: the placeholder until the real one is fully uploaded
+    // ------------------------------------------------------------------------
+    unsigned int texture(unsigned int handle) const
+    {
+        const Request& request = *requests[handle];
+        return request.resident ? request.id : placeholder;
+    }
+    bool resident(unsigned int handle) const
+    {
+        return requests[handle]->resident;
+    }
+    // true once every queued texture is resident (or failed to load)
+    bool idle() const
+    {
+        return loading.done() && uploads.empty();
+    }
+
+    // GL thread, once per frame after JobSystem::runMainThreadJobs() (which hands over the decoded
+    // images): stream decoded images into their textures within the frame budget
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        if (uploads.empty())
+            return;
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t budget = frameBudget;
+        while (!uploads.empty() && budget > 0)
+        {
+            Request& request = *requests[uploads.front()];
+            if (!request.image.ok)
+            {
+                std::cout << "Texture failed to load at path: " << request.path << std::endl;
+                uploads.pop_front();
+                continue;
+            }
+            if (!uploadBand(request, budget))
+                break;  // the next ring slot is still in use by the GPU: continue next frame
+            if (request.uploadedRows == request.image.rowCount(request.level))
+            {
+                request.uploadedRows = 0;
+                if (++request.level == (int)request.image.levels.size())
+                {
+                    finish(request);
+                    uploads.pop_front();
+                }
+            }
+        }
+        glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // delete every GL object owned by the loader (call while the context is still current)
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        for (auto& request : requests)
+        {
+            if (request->id != 0)
+            {
+                glDeleteTextures(1, &request->id);
+                glState().textureDeleted(request->id);
+            }
+        }
+        for (Slot& slot : slots)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.pbo);
+            glState().bufferDeleted(slot.pbo);
+        }
+        glDeleteTextures(1, &placeholder);
+        glState().textureDeleted(placeholder);
+    }
+
+private:
+    struct Request
+    {
+        std::string path;
+        bool colorData = true;
+        ImageData image;
+        unsigned int id = 0;
+        int level = 0;          // level and row the upload continues at
+        int uploadedRows = 0;
+        bool resident = false;
+    };
+    struct Slot
+    {
+        unsigned int pbo;
+        GLsync fence;  // signalled once the GPU has consumed the slot's last upload
+    };
+
+    JobSystem& jobs;
+    JobCounter loading;                 // decode and hand-over jobs in flight
+    std::vector<std::unique_ptr<Request>> requests;  // only grown by the GL thread; the jobs fill in image
+    std::deque<unsigned int> uploads;   // decoded, owned by the GL thread
+
+    std::vector<Slot> slots;
+    size_t slotBytes;
+    size_t frameBudget;
+    unsigned int nextSlot;
+    unsigned int placeholder;
+    bool supportsS3tc;
+
+    // use <path without extension>.gtex when it exists, is valid and its format is supported
+    bool loadBaked(Request& request) const
+    {
+        std::string path = request.path.substr(0, request.path.find_last_of('.')) + ".gtex";
+        TextureFile file;
+        if (!readTextureFile(path, file))
+            return false;
+        ImageData& image = request.image;
+        const TextureFileHeader& header = file.header;
+        if (header.format == TEXTURE_FORMAT_BC1)
+        {
+            if (!supportsS3tc)
+                return false;
+            image.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        }
+        else if (header.format == TEXTURE_FORMAT_BC4)
+            image.internalFormat = GL_COMPRESSED_RED_RGTC1;
+        else
+            image.internalFormat = GL_RGBA8;
+        image.format = GL_RGBA;
+        image.compressed = isBlockCompressed(header.format);
+        image.generateMips = false;
+        image.swizzleRed = (header.flags & TEXTURE_FLAG_SWIZZLE_RRR) != 0;
+        for (const TextureFileLevel& level : file.levels)
+            image.levels.push_back(ImageLevel{ (int)level.width, (int)level.height, (size_t)level.offset, (size_t)level.size });
+        image.pixels.swap(file.data);
+        image.ok = true;
+        return true;
+    }
+
+    static void decode(Request& request)
+    {
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load(request.path.c_str(), &width, &height, &nrComponents, 0);
+        if (!data)
+            return;
+        ImageData& image = request.image;
+        if (nrComponents <= 2)
+        {
+            image.format = nrComponents == 1 ? GL_RED : GL_RG;
+            image.internalFormat = image.format;
+            size_t size = (size_t)width * height * nrComponents;
+            image.levels.push_back(ImageLevel{ width, height, 0, size });
+            image.pixels.assign(data, data + size);
+            image.ok = true;
+            stbi_image_free(data);
+            return;
+        }
+
+        // RGB is widened to RGBA here rather than by the driver on the GL thread, then the whole
+        // mip chain is built while still on the worker
+        image.format = GL_RGBA;
+        image.internalFormat = GL_RGBA;
+        image.generateMips = false;
+        size_t total = 0;
+        for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2))
+        {
+            image.levels.push_back(ImageLevel{ w, h, total, (size_t)w * h * 4 });
+            total += (size_t)w * h * 4;
+            if (w == 1 && h == 1)
+                break;
+        }
+        image.pixels.resize(total);
+        if (nrComponents == 3)
+            imageExpandRgbToRgba(data, image.pixels.data(), (size_t)width * height);
+        else
+            std::memcpy(image.pixels.data(), data, (size_t)width * height * 4);
+        stbi_image_free(data);
+        for (size_t level = 1; level < image.levels.size(); level++)
+        {
+            const ImageLevel& source = image.levels[level - 1];
+            imageDownsampleBox(image.pixels.data() + source.offset, source.width, source.height,
+                               image.pixels.data() + image.levels[level].offset, request.colorData);
+        }
+        image.ok = true;
+    }
+
+    // copy the next band of rows into a ring slot and start its transfer; false if no slot is free
+    bool uploadBand(Request& request, size_t& budget)
+    {
+        Slot& slot = slots[nextSlot];
+        if (slot.fence)
+        {
+            if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                return false;
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+        }
+
+        const ImageData& image = request.image;
+        if (request.id == 0)
+        {
+            // allocate every level up front, the bands below only fill them in
+            glGenTextures(1, &request.id);
+            glState().bindTexture(GL_TEXTURE_2D, request.id);
+            for (size_t level = 0; level < image.levels.size(); level++)
+            {
+                const ImageLevel& size = image.levels[level];
+                if (image.compressed)
+                    glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, size.width, size.height, 0, (GLsizei)size.size, NULL);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, size.width, size.height, 0, image.format, GL_UNSIGNED_BYTE, NULL);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.generateMips ? 1000 : (GLint)image.levels.size() - 1);
+        }
+
+        const ImageLevel& level = image.levels[request.level];
+        size_t rowBytes = image.rowBytes(request.level);
+        int rows = (int)std::max<size_t>(1, std::min(slotBytes, budget) / rowBytes);
+        rows = std::min(rows, image.rowCount(request.level) - request.uploadedRows);
+        size_t bytes = rows * rowBytes;
+
+        glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (bytes > slotBytes)
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);  // a single row larger than a slot
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        std::memcpy(mapped, image.pixels.data() + level.offset + request.uploadedRows * rowBytes, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        int y = request.uploadedRows * image.rowHeight();
+        int height = std::min(rows * image.rowHeight(), level.height - y);
+        glState().bindTexture(GL_TEXTURE_2D, request.id);
+        if (image.compressed)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, request.level, 0, y, level.width, height, image.internalFormat, (GLsizei)bytes, (void*)0);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, request.level, 0, y, level.width, height, image.format, GL_UNSIGNED_BYTE, (void*)0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextSlot = (nextSlot + 1) % slots.size();
+
+        request.uploadedRows += rows;
+        budget = bytes >= budget ? 0 : budget - bytes;
+        return true;
+    }
+
+    static void finish(Request& request)
+    {
+        glState().bindTexture(GL_TEXTURE_2D, request.id);
+        if (request.image.generateMips)
+            glGenerateMipmap(GL_TEXTURE_2D);
+        if (request.image.swizzleRed)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        request.image = ImageData();  // free the CPU copy
+        request.resident = true;
+    }
+};
+#endif
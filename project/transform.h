@@ -0,0 +1,36 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+// true when the upper-left 3x3 of the model matrix is a rotation times one scale factor
+// ------------------------------------------------------------------------
+inline bool hasUniformScale(const glm::mat3& m, float epsilon = 1e-4f)
+{
+    float xx = glm::dot(m[0], m[0]);
+    float yy = glm::dot(m[1], m[1]);
+    float zz = glm::dot(m[2], m[2]);
+    float tolerance = epsilon * xx;
+    return std::fabs(xx - yy) <= tolerance && std::fabs(xx - zz) <= tolerance &&
+           std::fabs(glm::dot(m[0], m[1])) <= tolerance &&
+           std::fabs(glm::dot(m[1], m[2])) <= tolerance &&
+           std::fabs(glm::dot(m[0], m[2])) <= tolerance;
+}
+
+// the normal matrix is 'the transpose of the inverse of the upper-left 3x3 part of the model matrix'.
+// Normals are normalized in the fragment shader, so any positive multiple of it works as well:
+// - uniform scale: the 3x3 part itself is such a multiple, no inverse needed
+// - otherwise: the cofactor matrix equals determinant * transpose(inverse(m)), built from three
+//   cross products; the sign of the determinant keeps normals pointing out for mirrored transforms
+// ------------------------------------------------------------------------
+inline glm::mat3 normalMatrix(const glm::mat4& model)
+{
+    glm::mat3 m(model);
+    if (hasUniformScale(m))
+        return m;
+
+    glm::mat3 cofactor(glm::cross(m[1], m[2]), glm::cross(m[2], m[0]), glm::cross(m[0], m[1]));
+    return glm::dot(m[0], cofactor[0]) < 0.0f ? cofactor * -1.0f : cofactor;
+}
+#endif
@@ -0,0 +1,146 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// compile-time vertex layout descriptors: a vertex struct lists its members once in a
+// VertexFormat<> specialization and applyVertexFormat<>() generates the glVertexAttribPointer
+// calls from it, so strides and offsets always come from the struct itself.
+
+// packed attribute types
+// ------------------------------------------------------------------------
+struct Half4   // four half floats, used for positions (w = 1.0)
+{
+    uint16_t x, y, z, w;
+};
+struct Half2   // two half floats, used for texture coordinates
+{
+    uint16_t x, y;
+};
+struct PackedNormal   // signed normalized 10:10:10:2 (GL_INT_2_10_10_10_REV)
+{
+    uint32_t bits;
+};
+
+// how each C++ member type is described to GL
+// ------------------------------------------------------------------------
+template <typename T> struct VertexAttribType;
+template <> struct VertexAttribType<float>        { static constexpr GLint size = 1; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<glm::vec2>    { static constexpr GLint size = 2; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<glm::vec3>    { static constexpr GLint size = 3; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<glm::vec4>    { static constexpr GLint size = 4; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<Half2>        { static constexpr GLint size = 2; static constexpr GLenum type = GL_HALF_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<Half4>        { static constexpr GLint size = 4; static constexpr GLenum type = GL_HALF_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template <> struct VertexAttribType<PackedNormal> { static constexpr GLint size = 4; static constexpr GLenum type = GL_INT_2_10_10_10_REV; static constexpr GLboolean normalized = GL_TRUE; };
+
+struct VertexAttrib
+{
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+    size_t bytes;
+};
+
+template <typename T>
+constexpr VertexAttrib makeVertexAttrib(GLuint location, size_t offset)
+{
+    return VertexAttrib{ location, VertexAttribType<T>::size, VertexAttribType<T>::type, VertexAttribType<T>::normalized, offset, sizeof(T) };
+}
+
+// one entry of a VertexFormat<>::attribs table
+#define VERTEX_ATTRIB(VertexType, member, location) makeVertexAttrib<decltype(VertexType::member)>(location, offsetof(VertexType, member))
+
+// specialize with "static constexpr VertexAttrib attribs[] = { VERTEX_ATTRIB(...), ... };"
+template <typename Vertex> struct VertexFormat;
+
+// checked at compile time: every attribute fits in the vertex, none overlap and no location is used twice
+template <typename Vertex>
+constexpr bool isValidVertexFormat()
+{
+    constexpr size_t count = sizeof(VertexFormat<Vertex>::attribs) / sizeof(VertexAttrib);
+    for (size_t i = 0; i < count; i++)
+    {
+        const VertexAttrib& a = VertexFormat<Vertex>::attribs[i];
+        if (a.offset + a.bytes > sizeof(Vertex))
+            return false;
+        for (size_t j = i + 1; j < count; j++)
+        {
+            const VertexAttrib& b = VertexFormat<Vertex>::attribs[j];
+            if (a.location == b.location || (a.offset < b.offset + b.bytes && b.offset < a.offset + a.bytes))
+                return false;
+        }
+    }
+    return true;
+}
+
+// set up the attributes of the bound VAO for the vertex buffer bound to GL_ARRAY_BUFFER
+// ------------------------------------------------------------------------
+template <typename Vertex>
+void applyVertexFormat()
+{
+    static_assert(isValidVertexFormat<Vertex>(), "vertex format attributes overlap, share a location or exceed the vertex size");
+    for (const VertexAttrib& attrib : VertexFormat<Vertex>::attribs)
+    {
+        glVertexAttribPointer(attrib.location, attrib.size, attrib.type, attrib.normalized, sizeof(Vertex), (void*)attrib.offset);
+        glEnableVertexAttribArray(attrib.location);
+    }
+}
+
+// full precision vertex used while building meshes (32 bytes)
+// ------------------------------------------------------------------------
+struct Vertex
+{
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+};
+template <> struct VertexFormat<Vertex>
+{
+    static constexpr VertexAttrib attribs[] = {
+        VERTEX_ATTRIB(Vertex, Position, 0),
+        VERTEX_ATTRIB(Vertex, Normal, 1),
+        VERTEX_ATTRIB(Vertex, TexCoords, 2),
+    };
+};
+
+// GPU vertex (16 bytes): half float position, 10:10:10:2 normal, half float texture coordinates.
+// Half floats keep 11 significant bits, which is plenty for roughly unit sized meshes like the cube.
+// ------------------------------------------------------------------------
+struct PackedVertex
+{
+    Half4 Position;
+    PackedNormal Normal;
+    Half2 TexCoords;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay tightly packed");
+template <> struct VertexFormat<PackedVertex>
+{
+    static constexpr VertexAttrib attribs[] = {
+        VERTEX_ATTRIB(PackedVertex, Position, 0),
+        VERTEX_ATTRIB(PackedVertex, Normal, 1),
+        VERTEX_ATTRIB(PackedVertex, TexCoords, 2),
+    };
+};
+
+inline PackedVertex packVertex(const Vertex& vertex)
+{
+    PackedVertex packed;
+    packed.Position.x = glm::packHalf1x16(vertex.Position.x);
+    packed.Position.y = glm::packHalf1x16(vertex.Position.y);
+    packed.Position.z = glm::packHalf1x16(vertex.Position.z);
+    packed.Position.w = glm::packHalf1x16(1.0f);
+    packed.Normal.bits = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+    uint32_t texCoords = glm::packHalf2x16(vertex.TexCoords);
+    packed.TexCoords.x = (uint16_t)(texCoords & 0xFFFF);
+    packed.TexCoords.y = (uint16_t)(texCoords >> 16);
+    return packed;
+}
+#endif